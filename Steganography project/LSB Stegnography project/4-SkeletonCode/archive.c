@@ -0,0 +1,251 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "archive.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lsb_steg.h"
+#include "mmap_engine.h"
+
+/* Map fname read-only; an empty file maps to NULL */
+static unsigned char *map_input(const char *fname, size_t *size)
+{
+    struct stat st;
+    unsigned char *addr;
+    int fd = open(fname, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return MAP_FAILED;
+    }
+    *size = st.st_size;
+    addr = map_file(fd, *size, PROT_READ);
+    close(fd);  // The mapping keeps the file referenced
+    return addr;
+}
+
+static void unmap_input(unsigned char *addr, size_t size)
+{
+    if (addr != NULL && addr != MAP_FAILED)
+    {
+        munmap(addr, size);
+    }
+}
+
+/* Create fname with the given size and map it for writing */
+static unsigned char *create_output(const char *fname, size_t size)
+{
+    unsigned char *addr;
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        return MAP_FAILED;
+    }
+    addr = map_output_fd(fd, size);
+    close(fd);
+    return addr;
+}
+
+static const char *base_name(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash != NULL ? slash + 1 : path;
+}
+
+Status do_archive_encode(const char *image_fname, const char *out_fname, char *files[], int nfiles,
+                         const char *magic, const StegOptions *opts)
+{
+    StegFile *list = calloc(nfiles, sizeof(StegFile));
+    size_t image_size = 0;
+    unsigned char *image = MAP_FAILED, *out;
+    Status ret = e_failure;
+    int i;
+
+    if (list == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    for (i = 0; i < nfiles; i++)
+    {
+        list[i].name = base_name(files[i]);
+        for (int j = 0; j < i; j++)
+        {
+            if (strcmp(list[i].name, list[j].name) == 0)
+            {
+                fprintf(stderr, "ERROR: Two files are named %s\n", list[i].name);
+                goto unmap;
+            }
+        }
+        list[i].data = map_input(files[i], &list[i].size);
+        if (list[i].data == MAP_FAILED)
+        {
+            goto unmap;
+        }
+    }
+
+    image = map_input(image_fname, &image_size);
+    if (image == MAP_FAILED)
+    {
+        goto unmap;
+    }
+    out = create_output(out_fname, image_size);
+    if (out == MAP_FAILED)
+    {
+        goto unmap;
+    }
+    ret = steg_embed_archive(image, image_size, list, nfiles, magic, opts, out, NULL);
+    if (ret == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        unlink(out_fname);  // Never leave a half written image behind
+    }
+    else
+    {
+        LOG_INFO("INFO: %d files stored in %s\n", nfiles, out_fname);
+    }
+    unmap_input(out, image_size);
+
+unmap:
+    unmap_input(image, image_size);
+    while (--i >= 0)
+    {
+        unmap_input((unsigned char *)list[i].data, list[i].size);
+    }
+    free(list);
+    return ret;
+}
+
+/* Extract one file, or the requested range of it */
+static Status extract_entry(const unsigned char *image, size_t image_size, const StegHeader *hdr,
+                            const StegEntry *entry, const char *out_fname, const StegOptions *opts)
+{
+    size_t offset = opts->has_range ? opts->range_offset : 0;
+    size_t len = opts->has_range ? opts->range_length : entry->size;
+    unsigned char *out;
+    Status ret;
+
+    if (offset > entry->size || len > entry->size - offset)
+    {
+        fprintf(stderr, "ERROR: %s has only %zu bytes\n", entry->name, entry->size);
+        return e_failure;
+    }
+    out = create_output(out_fname, len);
+    if (out == MAP_FAILED)
+    {
+        return e_failure;
+    }
+    ret = steg_extract_range(image, image_size, hdr, entry, offset, len, opts, out);
+    if (ret == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+    }
+    else
+    {
+        LOG_INFO("INFO: %zu bytes of %s written to %s\n", len, entry->name, out_fname);
+    }
+    unmap_input(out, len);
+    return ret;
+}
+
+Status do_archive_decode(const char *image_fname, const char *out_fname, const char *magic,
+                         const StegOptions *opts)
+{
+    size_t image_size = 0;
+    unsigned char *image = map_input(image_fname, &image_size);
+    StegEntry *entries = NULL;
+    StegHeader hdr;
+    Status ret = e_failure;
+    size_t i;
+
+    if (image == MAP_FAILED)
+    {
+        return e_failure;
+    }
+    if (steg_read_header(image, image_size, magic, &hdr, NULL) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto unmap;
+    }
+    if (!hdr.is_archive)
+    {
+        fprintf(stderr, "ERROR: %s holds a single secret file, not an archive\n", image_fname);
+        goto unmap;
+    }
+    entries = malloc((hdr.archive_entries > 0 ? hdr.archive_entries : 1) * sizeof(StegEntry));
+    if (entries == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        goto unmap;
+    }
+    if (steg_read_toc(image, image_size, &hdr, entries) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto unmap;
+    }
+
+    if (opts->list_archive)
+    {
+        for (i = 0; i < hdr.archive_entries; i++)
+        {
+            printf("%12zu  %s\n", entries[i].size, entries[i].name);
+        }
+        printf("%zu files, %zu bytes\n", hdr.archive_entries, hdr.secret_size);
+        ret = e_success;
+        goto unmap;
+    }
+
+    for (i = 0; i < hdr.archive_entries && strcmp(entries[i].name, opts->extract_name) != 0; i++);
+    if (i == hdr.archive_entries)
+    {
+        fprintf(stderr, "ERROR: %s is not in the archive\n", opts->extract_name);
+        goto unmap;
+    }
+    // Names come from the image, never let one leave the current directory
+    ret = extract_entry(image, image_size, &hdr, &entries[i],
+                        out_fname != NULL ? out_fname : base_name(entries[i].name), opts);
+
+unmap:
+    free(entries);
+    unmap_input(image, image_size);
+    return ret;
+}
+
+#else
+
+Status do_archive_encode(const char *image_fname, const char *out_fname, char *files[], int nfiles,
+                         const char *magic, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Archive mode is not supported on this platform\n");
+    return e_failure;
+}
+
+Status do_archive_decode(const char *image_fname, const char *out_fname, const char *magic,
+                         const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Archive mode is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
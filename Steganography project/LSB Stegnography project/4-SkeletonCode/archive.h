@@ -0,0 +1,31 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Archive mode: several files in one carrier behind a table of contents
+ * (name, offset, size and CRC32C of each file) placed right after the
+ * magic string. Listing reads only the table of contents, and extracting
+ * one file or a byte range of it reads only that part of the carrier.
+ */
+
+/* Put every file in an archive in a copy of image_fname; files are stored under their base names */
+Status do_archive_encode(const char *image_fname, const char *out_fname, char *files[], int nfiles,
+                         const char *magic, const StegOptions *opts);
+
+/*
+ * List the archive in image_fname (opts->list_archive) or extract the file
+ * opts->extract_name, or the opts->range_* bytes of it, to out_fname or,
+ * when out_fname is NULL, to the file's own name.
+ */
+Status do_archive_decode(const char *image_fname, const char *out_fname, const char *magic,
+                         const StegOptions *opts);
+
+#endif
@@ -0,0 +1,267 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+#include "types.h"
+#include "encode.h"
+#include "decode.h"
+#include "mmap_engine.h"
+#include "lsb_kernel.h"
+#include "parallel.h"
+
+#define MAX_MANIFEST_LINE 4096
+#define MAX_JOB_FIELDS 5
+
+typedef struct _BatchJob
+{
+    int line;                       // Line number in the manifest
+    char *text;                     // Copy of the line, split in place by split_fields
+    char *field[MAX_JOB_FIELDS];
+    int nfields;
+
+    Status status;
+    double elapsed;
+} BatchJob;
+
+typedef struct _Batch
+{
+    BatchJob *jobs;
+    size_t njobs;
+    StegOptions job_opts;           // Options every job runs with
+} Batch;
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Split a manifest line on commas */
+static int split_fields(char *text, char *field[])
+{
+    int n = 0;
+
+    text[strcspn(text, "\r\n")] = '\0';
+    field[n++] = text;
+    for (char *p = text; *p != '\0' && n < MAX_JOB_FIELDS; p++)
+    {
+        if (*p == ',')
+        {
+            *p = '\0';
+            field[n++] = p + 1;
+        }
+    }
+    return n;
+}
+
+static Status run_encode_job(BatchJob *job, const StegOptions *opts)
+{
+    EncodeInfo *encInfo = calloc(1, sizeof(EncodeInfo));
+    Status ret = e_failure;
+
+    if (encInfo == NULL || job->nfields != 5 || strlen(job->field[4]) >= sizeof(encInfo->magic_string))
+    {
+        free(encInfo);
+        return e_failure;
+    }
+    encInfo->src_image_fname = job->field[1];
+    encInfo->secret_fname = job->field[2];
+    encInfo->stego_image_fname = job->field[3];
+    encInfo->opts = opts;
+    strcpy(encInfo->magic_string, job->field[4]);
+
+    if (open_files(encInfo) == e_success &&
+        check_capacity(encInfo) == e_success)
+    {
+        rewind(encInfo->fptr_src_image);
+        ret = opts->use_mmap ? do_encoding_mmap(encInfo) : do_encoding(encInfo);
+    }
+
+    if (encInfo->fptr_src_image != NULL)
+    {
+        fclose(encInfo->fptr_src_image);
+    }
+    if (encInfo->fptr_secret != NULL)
+    {
+        fclose(encInfo->fptr_secret);
+    }
+    if (encInfo->fptr_stego_image != NULL && fclose(encInfo->fptr_stego_image) != 0)
+    {
+        ret = e_failure;
+    }
+    free(encInfo);
+    return ret;
+}
+
+static Status run_decode_job(BatchJob *job, const StegOptions *opts)
+{
+    DecodeInfo *decInfo = calloc(1, sizeof(DecodeInfo));
+    Status ret;
+
+    if (decInfo == NULL || job->nfields != 4 ||
+        strlen(job->field[2]) >= sizeof(decInfo->secret_fname) ||
+        strlen(job->field[3]) >= sizeof(decInfo->magic_string))
+    {
+        free(decInfo);
+        return e_failure;
+    }
+    decInfo->stego_image_fname = job->field[1];
+    decInfo->opts = opts;
+    strcpy(decInfo->magic_string, job->field[3]);
+
+    // The decoded extension replaces the one given in the manifest
+    strcpy(decInfo->secret_fname, job->field[2]);
+    decInfo->secret_fname[secret_file_stem_len(job->field[2])] = '\0';
+
+    ret = opts->use_mmap ? do_decoding_mmap(decInfo) : do_decoding(decInfo);
+
+    if (decInfo->fptr_stego_image != NULL)
+    {
+        fclose(decInfo->fptr_stego_image);
+    }
+    if (decInfo->fptr_secret != NULL && fclose(decInfo->fptr_secret) != 0)
+    {
+        ret = e_failure;
+    }
+    free(decInfo);
+    return ret;
+}
+
+static void run_batch_job(size_t index, void *arg)
+{
+    Batch *batch = arg;
+    BatchJob *job = &batch->jobs[index];
+    double start = get_time_sec();
+
+    if (strcmp(job->field[0], "e") == 0)
+    {
+        job->status = run_encode_job(job, &batch->job_opts);
+    }
+    else if (strcmp(job->field[0], "d") == 0)
+    {
+        job->status = run_decode_job(job, &batch->job_opts);
+    }
+    else
+    {
+        job->status = e_failure;
+    }
+    job->elapsed = get_time_sec() - start;
+}
+
+/* Read every job line of the manifest into batch->jobs */
+static Status read_manifest(const char *manifest_fname, Batch *batch)
+{
+    FILE *fptr = fopen(manifest_fname, "r");
+    char text[MAX_MANIFEST_LINE];
+    size_t capacity = 0;
+    int line = 0;
+
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", manifest_fname);
+        return e_failure;
+    }
+
+    while (fgets(text, sizeof(text), fptr) != NULL)
+    {
+        BatchJob *job;
+
+        line++;
+        if (text[0] == '#' || text[strspn(text, " \t\r\n")] == '\0')
+        {
+            continue;
+        }
+        if (batch->njobs == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            job = realloc(batch->jobs, capacity * sizeof(BatchJob));
+            if (job == NULL)
+            {
+                fprintf(stderr, "ERROR: Out of memory\n");
+                fclose(fptr);
+                return e_failure;
+            }
+            batch->jobs = job;
+        }
+
+        job = &batch->jobs[batch->njobs];
+        job->text = strdup(text);
+        if (job->text == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            fclose(fptr);
+            return e_failure;
+        }
+        batch->njobs++;
+        job->line = line;
+        job->nfields = split_fields(job->text, job->field);
+        job->status = e_failure;
+        job->elapsed = 0;
+    }
+
+    fclose(fptr);
+    return e_success;
+}
+
+static void free_batch(Batch *batch)
+{
+    for (size_t i = 0; i < batch->njobs; i++)
+    {
+        free(batch->jobs[i].text);
+    }
+    free(batch->jobs);
+}
+
+Status do_batch(const char *manifest_fname, const StegOptions *opts)
+{
+    Batch batch = { NULL, 0, *opts };
+    int nworkers = opts->num_threads;
+    size_t failed = 0;
+    double start;
+
+    if (read_manifest(manifest_fname, &batch) == e_failure)
+    {
+        free_batch(&batch);
+        return e_failure;
+    }
+
+    // Parallelism comes from running jobs side by side, each job is single threaded
+    if (nworkers < 1)
+    {
+        nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    batch.job_opts.num_threads = 1;
+    lsb_kernel_init();  // Pick the kernel before any worker thread uses it
+
+    start = get_time_sec();
+    if (run_parallel(nworkers, batch.njobs, run_batch_job, &batch) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        free_batch(&batch);
+        return e_failure;
+    }
+
+    for (size_t i = 0; i < batch.njobs; i++)
+    {
+        BatchJob *job = &batch.jobs[i];
+        printf("JOB %d: %s %s %s %.3f ms\n", job->line, job->field[0],
+               job->nfields > 1 ? job->field[1] : "-",
+               job->status == e_success ? "OK" : "FAILED", job->elapsed * 1000);
+        failed += job->status != e_success;
+    }
+    LOG_INFO("INFO: %zu jobs, %zu failed, %zu workers, %.3f s\n", batch.njobs, failed,
+           (size_t)nworkers, get_time_sec() - start);
+
+    free_batch(&batch);
+    return failed ? e_failure : e_success;
+}
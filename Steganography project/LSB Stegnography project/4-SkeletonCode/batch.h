@@ -0,0 +1,25 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Batch mode: run every job listed in a CSV manifest on a worker pool.
+ * One job per line, blank lines and lines starting with '#' are skipped:
+ *
+ *   e,<.bmp file>,<secret file>,<output .bmp file>,<magic string>
+ *   d,<.bmp file>,<output file>,<magic string>
+ *
+ * Jobs run concurrently, so a decode job cannot rely on an encode job
+ * from the same manifest. Prints one status line with the wall time
+ * per job, in manifest order.
+ */
+Status do_batch(const char *manifest_fname, const StegOptions *opts);
+
+#endif
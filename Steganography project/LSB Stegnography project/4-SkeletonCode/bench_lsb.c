@@ -0,0 +1,174 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Microbenchmark for the LSB embed and extract kernels
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lsb_kernel.h"
+
+#define BENCH_PAYLOAD_SIZE (4 * 1024 * 1024)
+#define BENCH_REPEAT 10
+
+/* Odd and unaligned cases the 4 MB run never reaches */
+#define CHECK_MAX_LEN 4099
+#define CHECK_MAX_OFFSET 7
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Compare the active kernel with the scalar one at every depth, for
+ * lengths that leave a tail after the wide loops and for buffers that
+ * do not start on a vector boundary
+ */
+static int check_depths(const char *name, const unsigned char *payload, const unsigned char *carrier)
+{
+    static const size_t lens[] = { 1, 2, 3, 5, 7, 8, 9, 15, 17, 31, 33, 63, 65, 127, 1023, 1025, CHECK_MAX_LEN };
+    size_t max_carrier = lsb_carrier_bytes(CHECK_MAX_LEN, 1) + CHECK_MAX_OFFSET;
+    unsigned char *ref = malloc(max_carrier);
+    unsigned char *out = malloc(max_carrier);
+    unsigned char *ref_payload = malloc(CHECK_MAX_LEN + CHECK_MAX_OFFSET);
+    unsigned char *decoded = malloc(CHECK_MAX_LEN + CHECK_MAX_OFFSET);
+    int ret = 0;
+
+    if (ref == NULL || out == NULL || ref_payload == NULL || decoded == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        ret = 1;
+        goto done;
+    }
+
+    for (int depth = 1; depth <= 4 && ret == 0; depth++)
+    {
+        for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]) && ret == 0; l++)
+        {
+            for (size_t off = 0; off <= CHECK_MAX_OFFSET && ret == 0; off++)
+            {
+                size_t len = lens[l];
+                size_t bytes = lsb_carrier_bytes(len, depth);
+
+                lsb_kernel_select("scalar");
+                lsb_embed_depth(ref + off, carrier + off, payload + off, len, depth);
+                lsb_extract_depth(ref_payload + off, carrier + off, len, depth);
+                lsb_kernel_select(name);
+                memset(out, 0, max_carrier);
+                memset(decoded, 0, CHECK_MAX_LEN + CHECK_MAX_OFFSET);
+                lsb_embed_depth(out + off, carrier + off, payload + off, len, depth);
+                lsb_extract_depth(decoded + off, carrier + off, len, depth);
+
+                if (memcmp(out + off, ref + off, bytes) != 0 || memcmp(decoded + off, ref_payload + off, len) != 0)
+                {
+                    printf("%-8s differs from scalar kernel at depth %d, length %zu, offset %zu!\n",
+                           name, depth, len, off);
+                    ret = 1;
+                }
+            }
+        }
+    }
+
+done:
+    free(ref);
+    free(out);
+    free(ref_payload);
+    free(decoded);
+    return ret;
+}
+
+int main(void)
+{
+    const char *names[] = { "scalar", "sse2", "bmi2", "avx2" };
+    size_t len = BENCH_PAYLOAD_SIZE;
+    unsigned char *payload = malloc(len);
+    unsigned char *carrier = malloc(8 * len);
+    unsigned char *expected = malloc(8 * len);
+    unsigned char *out = malloc(8 * len);
+    unsigned char *decoded = malloc(len);
+    int ret = 0;
+
+    if (payload == NULL || carrier == NULL || expected == NULL || out == NULL || decoded == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for (size_t i = 0; i < len; i++)
+    {
+        payload[i] = rand();
+    }
+    for (size_t i = 0; i < 8 * len; i++)
+    {
+        carrier[i] = rand();
+    }
+
+    lsb_kernel_select("scalar");
+    lsb_embed(expected, carrier, payload, len);
+
+    printf("%-8s %12s %10s %12s %10s\n", "kernel", "embed MB/s", "speedup", "extract MB/s", "speedup");
+    double scalar_best = 0, scalar_extract_best = 0;
+    for (size_t k = 0; k < sizeof(names) / sizeof(names[0]); k++)
+    {
+        double best = 1e30, extract_best = 1e30;
+
+        if (lsb_kernel_select(names[k]) == e_failure)
+        {
+            printf("%-8s %12s\n", names[k], "unsupported");
+            continue;
+        }
+
+        if (check_depths(names[k], payload, carrier) != 0)
+        {
+            ret = 1;
+            continue;
+        }
+
+        for (int r = 0; r < BENCH_REPEAT; r++)
+        {
+            double start = get_time_sec();
+            lsb_embed(out, carrier, payload, len);
+            double elapsed = get_time_sec() - start;
+            if (elapsed < best)
+            {
+                best = elapsed;
+            }
+
+            start = get_time_sec();
+            lsb_extract(decoded, expected, len);
+            elapsed = get_time_sec() - start;
+            if (elapsed < extract_best)
+            {
+                extract_best = elapsed;
+            }
+        }
+
+        if (memcmp(out, expected, 8 * len) != 0 || memcmp(decoded, payload, len) != 0)
+        {
+            printf("%-8s output differs from scalar kernel!\n", names[k]);
+            ret = 1;
+            continue;
+        }
+
+        if (k == 0)
+        {
+            scalar_best = best;
+            scalar_extract_best = extract_best;
+        }
+        printf("%-8s %12.1f %9.2fx %12.1f %9.2fx\n", names[k], len / best / (1024 * 1024), scalar_best / best,
+               len / extract_best / (1024 * 1024), scalar_extract_best / extract_best);
+    }
+
+    free(payload);
+    free(carrier);
+    free(expected);
+    free(out);
+    free(decoded);
+    return ret;
+}
@@ -0,0 +1,642 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Encode/decode throughput benchmark over synthetic BMP carriers
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "encode.h"
+#include "decode.h"
+#include "bmp.h"
+#include "lsb_kernel.h"
+#include "mmap_engine.h"
+#include "parallel.h"
+#include "crc32c.h"
+
+#define BENCH_MAX_SAMPLES 100
+#define BENCH_MAX_STAGES 8
+#define BENCH_MAX_PAYLOAD (1L << 30)
+#define BENCH_MAGIC "#*#"
+#define BENCH_SLAB (32 * 1024)                  // Payload bytes per slab, as in lsb_steg.c
+#define BENCH_SLAB_MAX_PAYLOAD (16L << 20)      // Slab runs use in-memory buffers, 8x this for the carrier
+
+/* Timings of one stage across all repeats */
+typedef struct _StageTimes
+{
+    const char *name;
+    double bytes;                       // Bytes the stage moves, for MB/s
+    double sec[BENCH_MAX_SAMPLES];
+} StageTimes;
+
+typedef struct _BenchRun
+{
+    const char *path;                   // "stdio", "mmap", "mmap_threads" or "slabs_threads"
+    const char *kernel;
+    int threads;
+    int verified;                       // Decoded payload matched
+    int nstages;
+    StageTimes stage[BENCH_MAX_STAGES];
+} BenchRun;
+
+static int repeat = 5;
+static int stdout_fd = -1;
+static const char *best_kernel;        // Kernel lsb_kernel_init picked, used for the mmap paths
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The encoder and decoder report progress on stdout; keep it out of the measurements */
+static void quiet_stdout(int quiet)
+{
+    fflush(stdout);
+    if (quiet)
+    {
+        int null_fd = open("/dev/null", O_WRONLY);
+        stdout_fd = dup(STDOUT_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    else if (stdout_fd >= 0)
+    {
+        dup2(stdout_fd, STDOUT_FILENO);
+        close(stdout_fd);
+        stdout_fd = -1;
+    }
+}
+
+static unsigned long long rng_state = 88172645463325252ULL;
+
+static unsigned long long rng_next(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void fill_random(unsigned char *buf, size_t n)
+{
+    for (size_t i = 0; i < n; i += 8)
+    {
+        unsigned long long v = rng_next();
+        memcpy(buf + i, &v, n - i < 8 ? n - i : 8);
+    }
+}
+
+static void put_le32(unsigned char *p, uint v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* Write a width x height BMP with random pixels, row by row */
+static Status write_bmp(const char *fname, int width, int height, int bpp)
+{
+    unsigned char header[BMP_HEADER_SIZE] = { 'B', 'M' };
+    size_t row_bytes = (size_t)width * (bpp / 8);
+    size_t stride = (row_bytes + 3) & ~(size_t)3;
+    unsigned char *row = calloc(1, stride);
+    FILE *fptr = fopen(fname, "wb");
+    Status ret = e_success;
+
+    if (row == NULL || fptr == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to create %s\n", fname);
+        free(row);
+        if (fptr != NULL)
+        {
+            fclose(fptr);
+        }
+        return e_failure;
+    }
+
+    put_le32(header + 2, BMP_HEADER_SIZE + stride * height);
+    put_le32(header + 10, BMP_HEADER_SIZE);
+    put_le32(header + 14, 40);
+    put_le32(header + 18, width);
+    put_le32(header + 22, height);
+    header[26] = 1;
+    header[28] = bpp;
+    put_le32(header + 34, stride * height);
+    fwrite(header, sizeof(header), 1, fptr);
+
+    for (int y = 0; y < height && ret == e_success; y++)
+    {
+        fill_random(row, row_bytes);
+        if (fwrite(row, stride, 1, fptr) != 1)
+        {
+            fprintf(stderr, "ERROR: Unable to write %s\n", fname);
+            ret = e_failure;
+        }
+    }
+    if (fclose(fptr) != 0)
+    {
+        ret = e_failure;
+    }
+    free(row);
+    return ret;
+}
+
+static Status write_payload(const char *fname, size_t size)
+{
+    unsigned char buf[64 * 1024];
+    FILE *fptr = fopen(fname, "wb");
+
+    if (fptr == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to create %s\n", fname);
+        return e_failure;
+    }
+    while (size > 0)
+    {
+        size_t n = size < sizeof(buf) ? size : sizeof(buf);
+        fill_random(buf, n);
+        fwrite(buf, n, 1, fptr);
+        size -= n;
+    }
+    return fclose(fptr) == 0 ? e_success : e_failure;
+}
+
+/* Compare two files byte for byte */
+static int same_file(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "rb"), *fb = fopen(b, "rb");
+    char ba[64 * 1024], bb[64 * 1024];
+    int same = fa != NULL && fb != NULL;
+
+    while (same)
+    {
+        size_t na = fread(ba, 1, sizeof(ba), fa);
+        size_t nb = fread(bb, 1, sizeof(bb), fb);
+        same = na == nb && memcmp(ba, bb, na) == 0;
+        if (na == 0)
+        {
+            break;
+        }
+    }
+    if (fa != NULL)
+    {
+        fclose(fa);
+    }
+    if (fb != NULL)
+    {
+        fclose(fb);
+    }
+    return same;
+}
+
+static StageTimes *stage(BenchRun *run, const char *name, double bytes)
+{
+    for (int i = 0; i < run->nstages; i++)
+    {
+        if (strcmp(run->stage[i].name, name) == 0)
+        {
+            return &run->stage[i];
+        }
+    }
+    run->stage[run->nstages].name = name;
+    run->stage[run->nstages].bytes = bytes;
+    return &run->stage[run->nstages++];
+}
+
+static void setup_encode(EncodeInfo *encInfo, const StegOptions *opts)
+{
+    memset(encInfo, 0, sizeof(*encInfo));
+    encInfo->src_image_fname = "bench_carrier.bmp";
+    encInfo->secret_fname = "bench_payload.bin";
+    encInfo->stego_image_fname = "bench_stego.bmp";
+    encInfo->opts = opts;
+    strcpy(encInfo->magic_string, BENCH_MAGIC);
+}
+
+static void close_encode(EncodeInfo *encInfo)
+{
+    fclose(encInfo->fptr_src_image);
+    fclose(encInfo->fptr_secret);
+    fclose(encInfo->fptr_stego_image);
+}
+
+static void setup_decode(DecodeInfo *decInfo, const StegOptions *opts)
+{
+    memset(decInfo, 0, sizeof(*decInfo));
+    decInfo->stego_image_fname = "bench_stego.bmp";
+    strcpy(decInfo->secret_fname, "bench_out");
+    strcpy(decInfo->magic_string, BENCH_MAGIC);
+    decInfo->opts = opts;
+}
+
+/* Time every stage of the stdio encoder and decoder once */
+static Status run_stdio_stages(BenchRun *run, int r, size_t payload_size, size_t file_size)
+{
+    static EncodeInfo encInfo;
+    static DecodeInfo decInfo;
+    StegOptions opts = { .num_threads = 1, .lsb_depth = 1 };
+    double t[6];
+    Status ret = e_failure;
+
+    setup_encode(&encInfo, &opts);
+    if (open_files(&encInfo) == e_failure || check_capacity(&encInfo) == e_failure)
+    {
+        return e_failure;
+    }
+
+    t[0] = get_time_sec();
+    copy_bmp_header(encInfo.fptr_src_image, encInfo.fptr_stego_image, encInfo.bmp.pixel_offset);
+    pixel_iter_init(&encInfo.iter, &encInfo.bmp, encInfo.fptr_src_image, encInfo.fptr_stego_image);
+    t[1] = get_time_sec();
+    encode_magic_string(encInfo.magic_string, &encInfo);
+    encode_header_format(&encInfo);
+    t[2] = get_time_sec();
+    encode_secret_file_extn(&encInfo);
+    t[3] = get_time_sec();
+    if (encode_secret_file_data(&encInfo) == e_success)
+    {
+        pixel_iter_close(&encInfo.iter);
+        t[4] = get_time_sec();
+        ret = copy_remaining_img_data(encInfo.fptr_src_image, encInfo.fptr_stego_image);
+        t[5] = get_time_sec();
+    }
+    pixel_iter_close(&encInfo.iter);
+    close_encode(&encInfo);
+    if (ret == e_failure)
+    {
+        return e_failure;
+    }
+
+    stage(run, "copy_bmp_header", encInfo.bmp.pixel_offset)->sec[r] = t[1] - t[0];
+    stage(run, "encode_magic_string", 0)->sec[r] = t[2] - t[1];
+    stage(run, "encode_secret_file_extn", 0)->sec[r] = t[3] - t[2];
+    stage(run, "encode_secret_file_data", payload_size)->sec[r] = t[4] - t[3];
+    stage(run, "copy_remaining_img_data", file_size - bmp_carrier_end(&encInfo.bmp, encInfo.iter.pos))->sec[r] = t[5] - t[4];
+
+    setup_decode(&decInfo, &opts);
+    if (open_file(&decInfo) == e_failure || read_bmp_info(decInfo.fptr_stego_image, &decInfo.bmp) == e_failure)
+    {
+        return e_failure;
+    }
+    ret = e_failure;
+    t[0] = get_time_sec();
+    if (decode_magic_string(&decInfo) == e_success && decode_header_format(&decInfo) == e_success)
+    {
+        t[1] = get_time_sec();
+        if (decode_secret_file_extn(&decInfo) == e_success)
+        {
+            t[2] = get_time_sec();
+            ret = decode_secret_file_data(&decInfo);
+            t[3] = get_time_sec();
+        }
+    }
+    pixel_iter_close(&decInfo.iter);
+    fclose(decInfo.fptr_stego_image);
+    if (decInfo.fptr_secret != NULL)
+    {
+        fclose(decInfo.fptr_secret);
+    }
+    if (ret == e_failure)
+    {
+        return e_failure;
+    }
+
+    stage(run, "decode_magic_string", 0)->sec[r] = t[1] - t[0];
+    stage(run, "decode_secret_file_extn", 0)->sec[r] = t[2] - t[1];
+    stage(run, "decode_secret_file_data", payload_size)->sec[r] = t[3] - t[2];
+    return e_success;
+}
+
+/* Time a whole mmap encode and decode once */
+static Status run_mmap(BenchRun *run, int r, size_t payload_size, int threads)
+{
+    static EncodeInfo encInfo;
+    static DecodeInfo decInfo;
+    StegOptions opts = { .use_mmap = 1, .num_threads = threads, .lsb_depth = 1 };
+    double t[3];
+    Status ret;
+
+    setup_encode(&encInfo, &opts);
+    if (open_files(&encInfo) == e_failure || check_capacity(&encInfo) == e_failure)
+    {
+        return e_failure;
+    }
+    t[0] = get_time_sec();
+    ret = do_encoding_mmap(&encInfo);
+    t[1] = get_time_sec();
+    close_encode(&encInfo);
+
+    setup_decode(&decInfo, &opts);
+    if (ret == e_failure || do_decoding_mmap(&decInfo) == e_failure)
+    {
+        return e_failure;
+    }
+    t[2] = get_time_sec();
+
+    stage(run, "do_encoding_mmap", payload_size)->sec[r] = t[1] - t[0];
+    stage(run, "do_decoding_mmap", payload_size)->sec[r] = t[2] - t[1];
+    return e_success;
+}
+
+/* One threaded LSB pass over in-memory buffers */
+typedef struct _SlabBench
+{
+    const unsigned char *payload;
+    unsigned char *carrier;
+    size_t len;
+    uint *crcs;                         // Per-slab CRC32C, NULL for the LSB pass alone
+} SlabBench;
+
+static void bench_slab(size_t job, void *arg)
+{
+    SlabBench *sb = arg;
+    size_t off = job * BENCH_SLAB;
+    size_t n = sb->len - off < BENCH_SLAB ? sb->len - off : BENCH_SLAB;
+
+    if (sb->crcs != NULL)
+    {
+        sb->crcs[job] = crc32c_update(0, sb->payload + off, n);
+    }
+    lsb_embed(sb->carrier + 8 * off, sb->carrier + 8 * off, sb->payload + off, n);
+}
+
+/*
+ * Time the slab pass of -j on its own and with the per-slab CRC32C the
+ * encoder adds to it, so the cost of the checksum under threads shows up
+ * next to the LSB work it runs beside.
+ */
+static Status run_slab_crc(BenchRun *run, int r, size_t payload_size, int threads)
+{
+    size_t len = payload_size < BENCH_SLAB_MAX_PAYLOAD ? payload_size : BENCH_SLAB_MAX_PAYLOAD;
+    size_t njobs = (len + BENCH_SLAB - 1) / BENCH_SLAB;
+    unsigned char *payload = malloc(len);
+    unsigned char *carrier = malloc(8 * len);
+    uint *crcs = malloc(njobs * sizeof(*crcs));
+    SlabBench sb = { payload, carrier, len, NULL };
+    Status ret = e_failure;
+    uint crc = 0;
+    double t[3];
+
+    if (payload != NULL && carrier != NULL && crcs != NULL)
+    {
+        fill_random(payload, len);
+        fill_random(carrier, 8 * len);  // Fault the pages in before the clock starts
+
+        t[0] = get_time_sec();
+        run_parallel(threads, njobs, bench_slab, &sb);
+        t[1] = get_time_sec();
+        sb.crcs = crcs;
+        run_parallel(threads, njobs, bench_slab, &sb);
+        for (size_t job = 0; job < njobs; job++)
+        {
+            crc = crc32c_combine(crc, crcs[job], job + 1 < njobs ? BENCH_SLAB : len - job * BENCH_SLAB);
+        }
+        t[2] = get_time_sec();
+
+        if (crc == crc32c_update(0, payload, len))
+        {
+            stage(run, "embed_slabs", len)->sec[r] = t[1] - t[0];
+            stage(run, "embed_slabs_crc32c", len)->sec[r] = t[2] - t[1];
+            ret = e_success;
+        }
+    }
+    free(payload);
+    free(carrier);
+    free(crcs);
+    return ret;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, int n, double q)
+{
+    int rank = (int)(q * n + 0.999999);
+    return sorted[rank < 1 ? 0 : rank - 1];
+}
+
+static void print_run(FILE *json, const BenchRun *run, int first)
+{
+    fprintf(json, "%s\n        {\"path\": \"%s\", \"kernel\": \"%s\", \"threads\": %d, \"verified\": %s, \"stages\": [",
+            first ? "" : ",", run->path, run->kernel, run->threads, run->verified ? "true" : "false");
+    for (int i = 0; i < run->nstages; i++)
+    {
+        double sorted[BENCH_MAX_SAMPLES];
+        double p50;
+
+        memcpy(sorted, run->stage[i].sec, repeat * sizeof(double));
+        qsort(sorted, repeat, sizeof(double), cmp_double);
+        p50 = percentile(sorted, repeat, 0.50);
+
+        fprintf(json, "%s\n          {\"name\": \"%s\", \"bytes\": %.0f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, "
+                "\"p99_ms\": %.4f, \"mb_per_s\": %.1f}",
+                i == 0 ? "" : ",", run->stage[i].name, run->stage[i].bytes, p50 * 1e3,
+                percentile(sorted, repeat, 0.90) * 1e3, percentile(sorted, repeat, 0.99) * 1e3,
+                p50 > 0 && run->stage[i].bytes > 0 ? run->stage[i].bytes / p50 / (1024 * 1024) : 0.0);
+
+        fprintf(stderr, "  %-13s %-7s %-26s p50 %9.3f ms %10.1f MB/s\n", run->path, run->kernel,
+                run->stage[i].name, p50 * 1e3,
+                p50 > 0 && run->stage[i].bytes > 0 ? run->stage[i].bytes / p50 / (1024 * 1024) : 0.0);
+    }
+    fprintf(json, "\n        ]}");
+}
+
+/* Benchmark every path on one carrier size; writes one JSON object */
+static void bench_carrier(FILE *json, int width, int height, int bpp, int threads, int first)
+{
+    static BenchRun run;
+    const char *kernels[] = { "scalar", "sse2", "bmi2", "avx2" };
+    const char *extra_paths[] = { "mmap", "mmap_threads", "slabs_threads" };  // Run with the best kernel
+    size_t nkernels = sizeof(kernels) / sizeof(kernels[0]);
+    size_t row_bytes = (size_t)width * (bpp / 8);
+    size_t file_size = BMP_HEADER_SIZE + ((row_bytes + 3) & ~(size_t)3) * height;
+    long payload_size = ((long)(row_bytes * height) - 512) / 16;  // Half of the depth 1 capacity
+    int nruns = 0;
+
+    if (payload_size > BENCH_MAX_PAYLOAD)
+    {
+        payload_size = BENCH_MAX_PAYLOAD;
+    }
+
+    fprintf(stderr, "%dx%d %d bpp, %zu bytes, payload %ld bytes\n", width, height, bpp, file_size,
+            payload_size > 0 ? payload_size : 0);
+    fprintf(json, "%s\n    {\"width\": %d, \"height\": %d, \"bpp\": %d, \"image_bytes\": %zu, \"payload_bytes\": %ld, ",
+            first ? "" : ",", width, height, bpp, file_size, payload_size > 0 ? payload_size : 0);
+
+    if (write_bmp("bench_carrier.bmp", width, height, bpp) == e_failure)
+    {
+        fprintf(json, "\"error\": \"unable to write carrier\", \"runs\": []}");
+        return;
+    }
+    if (payload_size <= 0)
+    {
+        // Too small for the stego header itself
+        fprintf(stderr, "  skipped, carrier too small\n");
+        fprintf(json, "\"error\": \"capacity\", \"runs\": []}");
+        remove("bench_carrier.bmp");
+        return;
+    }
+    write_payload("bench_payload.bin", payload_size);
+    fprintf(json, "\"runs\": [");
+
+    for (size_t k = 0; k < nkernels + sizeof(extra_paths) / sizeof(extra_paths[0]); k++)
+    {
+        Status ret = e_success;
+
+        memset(&run, 0, sizeof(run));
+        if (k < nkernels)
+        {
+            if (lsb_kernel_select(kernels[k]) == e_failure)
+            {
+                continue;  // Not supported by this CPU
+            }
+            run.path = "stdio";
+            run.threads = 1;
+        }
+        else
+        {
+            lsb_kernel_select(best_kernel);
+            run.path = extra_paths[k - nkernels];
+            run.threads = k == nkernels ? 1 : threads;
+        }
+        run.kernel = lsb_kernel_name();
+
+        quiet_stdout(1);
+        for (int r = 0; r < repeat && ret == e_success; r++)
+        {
+            remove("bench_out.bin");
+            if (strcmp(run.path, "stdio") == 0)
+            {
+                ret = run_stdio_stages(&run, r, payload_size, file_size);
+            }
+            else if (strcmp(run.path, "slabs_threads") == 0)
+            {
+                ret = run_slab_crc(&run, r, payload_size, run.threads);  // Fails if the merged CRC is wrong
+            }
+            else
+            {
+                ret = run_mmap(&run, r, payload_size, run.threads);
+            }
+        }
+        quiet_stdout(0);
+
+        run.verified = ret == e_success &&
+                       (strcmp(run.path, "slabs_threads") == 0 || same_file("bench_out.bin", "bench_payload.bin"));
+        if (ret == e_failure)
+        {
+            fprintf(stderr, "  %s %s failed\n", run.path, run.kernel);
+            run.nstages = 0;
+        }
+        print_run(json, &run, nruns++ == 0);
+    }
+    fprintf(json, "\n    ]}");
+
+    remove("bench_carrier.bmp");
+    remove("bench_payload.bin");
+    remove("bench_stego.bmp");
+    remove("bench_out.bin");
+}
+
+int main(int argc, char *argv[])
+{
+    const char *sizes = "6x6,64x64,1024x768,4096x4096";
+    const char *bpps = "24,32";
+    const char *out_fname = "bench_steg.json";
+    const char *dir = NULL;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? sysconf(_SC_NPROCESSORS_ONLN) : 2;
+    char list[256];
+    FILE *json;
+    int first = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 < argc && strcmp(argv[i], "-s") == 0)
+        {
+            sizes = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-b") == 0)
+        {
+            bpps = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-r") == 0)
+        {
+            repeat = atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-j") == 0)
+        {
+            threads = atoi(argv[++i]);
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-o") == 0)
+        {
+            out_fname = argv[++i];
+        }
+        else if (i + 1 < argc && strcmp(argv[i], "-d") == 0)
+        {
+            dir = argv[++i];
+        }
+        else
+        {
+            printf("Usage : %s [-s WxH,...] [-b 24,32] [-r repeats] [-j threads] [-o out.json] [-d work dir]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1 || repeat > BENCH_MAX_SAMPLES || threads < 1)
+    {
+        fprintf(stderr, "ERROR: -r must be 1 to %d and -j at least 1\n", BENCH_MAX_SAMPLES);
+        return 1;
+    }
+
+    json = fopen(out_fname, "w");
+    if (json == NULL)
+    {
+        perror("fopen");
+        return 1;
+    }
+    // Carriers are written next to the results unless -d says otherwise
+    if (dir != NULL && chdir(dir) != 0)
+    {
+        perror("chdir");
+        return 1;
+    }
+
+    lsb_kernel_init();
+    best_kernel = lsb_kernel_name();
+    fprintf(json, "{\n  \"cpus\": %ld,\n  \"best_kernel\": \"%s\",\n  \"repeat\": %d,\n  \"carriers\": [",
+            sysconf(_SC_NPROCESSORS_ONLN), lsb_kernel_name(), repeat);
+
+    snprintf(list, sizeof(list), "%s", sizes);
+    for (char *size = strtok(list, ","); size != NULL; size = strtok(NULL, ","))
+    {
+        int width, height;
+        char bpp_list[64];
+        char *save;
+
+        if (sscanf(size, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+        {
+            fprintf(stderr, "ERROR: Invalid size %s\n", size);
+            continue;
+        }
+        snprintf(bpp_list, sizeof(bpp_list), "%s", bpps);
+        for (char *bpp = strtok_r(bpp_list, ",", &save); bpp != NULL; bpp = strtok_r(NULL, ",", &save))
+        {
+            bench_carrier(json, width, height, atoi(bpp), threads, first);
+            first = 0;
+        }
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+    fprintf(stderr, "Results written to %s\n", out_fname);
+    return 0;
+}
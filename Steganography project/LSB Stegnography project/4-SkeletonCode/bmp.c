@@ -0,0 +1,501 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bmp.h"
+#include "common.h"
+#include "stats.h"
+#include "pipeline.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+/* Compression values that still store plain BGR(A) pixels */
+#define BI_RGB 0
+#define BI_BITFIELDS 3
+#define BI_ALPHABITFIELDS 6
+
+/* Gather and scatter of whole pixels for one pixel size and channel mask */
+typedef struct _ChannelKernels
+{
+    void (*gather)(const unsigned char *px, unsigned char *buf, size_t npixels);
+    void (*scatter)(unsigned char *px, const unsigned char *buf, size_t npixels);
+} ChannelKernels;
+
+/*
+ * PB and MASK are constants, so every channel test folds away and each
+ * pixel is a fixed run of loads and stores with no branch per byte.
+ */
+#define CHANNEL_KERNELS(PB, MASK) \
+static void gather_##PB##_##MASK(const unsigned char *px, unsigned char *buf, size_t npixels) \
+{ \
+    for (; npixels > 0; npixels--, px += (PB)) \
+    { \
+        if ((MASK) & 1) *buf++ = px[0]; \
+        if ((MASK) & 2) *buf++ = px[1]; \
+        if ((MASK) & 4) *buf++ = px[2]; \
+        if ((MASK) & 8) *buf++ = px[3]; \
+    } \
+} \
+static void scatter_##PB##_##MASK(unsigned char *px, const unsigned char *buf, size_t npixels) \
+{ \
+    for (; npixels > 0; npixels--, px += (PB)) \
+    { \
+        if ((MASK) & 1) px[0] = *buf++; \
+        if ((MASK) & 2) px[1] = *buf++; \
+        if ((MASK) & 4) px[2] = *buf++; \
+        if ((MASK) & 8) px[3] = *buf++; \
+    } \
+}
+
+/* Every mask short of all channels; all channels use the plain row layout */
+#define MASKS_24(X) X(3, 1) X(3, 2) X(3, 3) X(3, 4) X(3, 5) X(3, 6)
+#define MASKS_32(X) X(4, 1) X(4, 2) X(4, 3) X(4, 4) X(4, 5) X(4, 6) X(4, 7) \
+                    X(4, 8) X(4, 9) X(4, 10) X(4, 11) X(4, 12) X(4, 13) X(4, 14)
+
+MASKS_24(CHANNEL_KERNELS)
+MASKS_32(CHANNEL_KERNELS)
+
+#define KERNEL_ENTRY(PB, MASK) [MASK] = { gather_##PB##_##MASK, scatter_##PB##_##MASK },
+
+static const ChannelKernels kernels_24[8] = { MASKS_24(KERNEL_ENTRY) };
+static const ChannelKernels kernels_32[16] = { MASKS_32(KERNEL_ENTRY) };
+
+static uint read_le16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint read_le32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint)p[3] << 24);
+}
+
+Status parse_bmp_info(const unsigned char *data, size_t size, size_t file_size, BmpInfo *bmp)
+{
+    uint dib_size, compression;
+    int height;
+
+    if (size < BMP_HEADER_SIZE || data[0] != 'B' || data[1] != 'M')
+    {
+        steg_set_error("Not a BMP image");
+        return e_failure;
+    }
+
+    bmp->pixel_offset = read_le32(data + 10);
+    dib_size = read_le32(data + 14);
+    bmp->width = (int)read_le32(data + 18);
+    height = (int)read_le32(data + 22);
+    bmp->bits_per_pixel = read_le16(data + 28);
+    compression = read_le32(data + 30);
+
+    // BITMAPINFOHEADER and the V4/V5 headers that extend it
+    if (dib_size < 40 || read_le16(data + 26) != 1 || bmp->pixel_offset < BMP_HEADER_SIZE)
+    {
+        steg_set_error("Unsupported BMP header");
+        return e_failure;
+    }
+    if ((bmp->bits_per_pixel != 24 && bmp->bits_per_pixel != 32) ||
+        !(compression == BI_RGB || (bmp->bits_per_pixel == 32 &&
+          (compression == BI_BITFIELDS || compression == BI_ALPHABITFIELDS))))
+    {
+        steg_set_error("Only uncompressed 24 and 32 bpp BMP images are supported");
+        return e_failure;
+    }
+    if (bmp->width <= 0 || height == 0 || height == INT_MIN)
+    {
+        steg_set_error("Invalid BMP dimensions");
+        return e_failure;
+    }
+
+    bmp->top_down = height < 0;
+    bmp->height = height < 0 ? -height : height;
+    bmp->row_bytes = (size_t)bmp->width * (bmp->bits_per_pixel / 8);
+    bmp->stride = (bmp->row_bytes + 3) & ~(size_t)3;  // Rows are padded to 4 bytes
+    bmp->carrier_size = bmp->row_bytes * bmp->height;
+    bmp->file_size = file_size;
+    bmp->channel_mask = 0;
+    bmp->pixel_bytes = bmp->bits_per_pixel / 8;
+
+    // The last row may omit its padding
+    if (file_size != 0 &&
+        bmp->pixel_offset + bmp->stride * (bmp->height - 1) + bmp->row_bytes > file_size)
+    {
+        steg_set_error("BMP pixel array is truncated");
+        return e_failure;
+    }
+    return e_success;
+}
+
+Status read_bmp_info(FILE *fptr, BmpInfo *bmp)
+{
+    unsigned char header[BMP_HEADER_SIZE];
+    off_t file_size;
+
+    fseeko(fptr, 0, SEEK_END);
+    file_size = ftello(fptr);
+    rewind(fptr);
+
+    if (fread(header, sizeof(header), 1, fptr) != 1)
+    {
+        fprintf(stderr, "ERROR: Not a BMP image\n");
+        return e_failure;
+    }
+    if (parse_bmp_info(header, sizeof(header), file_size > 0 ? (size_t)file_size : 0, bmp) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        return e_failure;
+    }
+    return e_success;
+}
+
+void bmp_set_raw_layout(BmpInfo *bmp)
+{
+    bmp->pixel_offset = BMP_HEADER_SIZE;
+    bmp->height = 1;
+    bmp->row_bytes = bmp->stride = bmp->carrier_size =
+        bmp->file_size > BMP_HEADER_SIZE ? bmp->file_size - BMP_HEADER_SIZE : 0;
+}
+
+int bmp_is_raw_layout(const BmpInfo *bmp)
+{
+    return bmp->pixel_offset == BMP_HEADER_SIZE && bmp->stride == bmp->row_bytes;
+}
+
+Status bmp_check_channels(const BmpInfo *bmp, uint *mask)
+{
+    uint all = bmp->pixel_bytes == 4 ? 0xF : 0x7;
+
+    if ((*mask & ~all) != 0)
+    {
+        steg_set_error(bmp->pixel_bytes == 4 ? "Invalid channel mask" : "A 24 bpp image has no alpha channel");
+        return e_failure;
+    }
+    if (*mask == all)
+    {
+        *mask = 0;
+    }
+    return e_success;
+}
+
+Status bmp_set_channels(BmpInfo *bmp, size_t pos, uint mask)
+{
+    size_t rows = (pos + bmp->row_bytes - 1) / bmp->row_bytes;  // Rows with carrier bytes before pos
+    uint check = mask;
+
+    if (mask == 0 || bmp_check_channels(bmp, &check) == e_failure || bmp->channel_mask != 0 ||
+        (bmp->pixel_bytes != 3 && bmp->pixel_bytes != 4))
+    {
+        steg_set_error("Invalid channel mask");
+        return e_failure;
+    }
+    rows = rows < (size_t)bmp->height ? rows : (size_t)bmp->height;
+    bmp->pixel_offset += rows * bmp->stride;
+    bmp->height -= rows;
+    bmp->channel_mask = mask;
+    bmp->channel_base = pos;
+    bmp->channels = 0;
+    for (uint c = 0; c < bmp->pixel_bytes; c++)
+    {
+        if (mask & (1u << c))
+        {
+            bmp->channel_offset[bmp->channels++] = c;
+        }
+    }
+    bmp->row_carriers = (size_t)bmp->width * bmp->channels;
+    bmp->carrier_size = pos + bmp->row_carriers * bmp->height;
+    bmp->kernels = bmp->pixel_bytes == 4 ? &kernels_32[mask] : &kernels_24[mask];
+    return e_success;
+}
+
+int bmp_is_contiguous(const BmpInfo *bmp)
+{
+    return bmp->stride == bmp->row_bytes && bmp->channel_mask == 0;
+}
+
+size_t bmp_carrier_offset(const BmpInfo *bmp, size_t pos)
+{
+    if (bmp->channel_mask != 0)
+    {
+        size_t k = pos - bmp->channel_base;
+        size_t col = k % bmp->row_carriers;
+        return bmp->pixel_offset + k / bmp->row_carriers * bmp->stride +
+               col / bmp->channels * bmp->pixel_bytes + bmp->channel_offset[col % bmp->channels];
+    }
+    return bmp->pixel_offset + pos / bmp->row_bytes * bmp->stride + pos % bmp->row_bytes;
+}
+
+size_t bmp_carrier_end(const BmpInfo *bmp, size_t pos)
+{
+    if (bmp->channel_mask != 0 && pos <= bmp->channel_base)
+    {
+        return bmp->pixel_offset;
+    }
+    return pos == 0 ? bmp->pixel_offset : bmp_carrier_offset(bmp, pos - 1) + 1;
+}
+
+/*
+ * Move n carrier bytes between raw and buf under a channel mask, raw
+ * holding the file bytes from carrier byte pos on. Whole pixels go
+ * through the kernels; only a pixel cut by pos or pos + n goes byte by
+ * byte.
+ */
+static void channel_copy(const BmpInfo *bmp, size_t pos, unsigned char *raw, unsigned char *buf, size_t n,
+                         int to_raw)
+{
+    size_t col = (pos - bmp->channel_base) % bmp->row_carriers;
+    uint c = col % bmp->channels;
+    unsigned char *px = raw - bmp->channel_offset[c];  // Start of the pixel of carrier byte pos
+
+    while (n > 0)
+    {
+        size_t whole;
+
+        // Bytes of a cut pixel
+        while (n > 0 && (c != 0 || n < bmp->channels))
+        {
+            unsigned char *p = px + bmp->channel_offset[c];
+            if (to_raw)
+            {
+                *p = *buf++;
+            }
+            else
+            {
+                *buf++ = *p;
+            }
+            n--;
+            col++;
+            if (++c == bmp->channels)
+            {
+                c = 0;
+                px += bmp->pixel_bytes;
+                break;
+            }
+        }
+
+        whole = (bmp->row_carriers - col < n ? bmp->row_carriers - col : n) / bmp->channels;
+        if (to_raw)
+        {
+            bmp->kernels->scatter(px, buf, whole);
+        }
+        else
+        {
+            bmp->kernels->gather(px, buf, whole);
+        }
+        buf += whole * bmp->channels;
+        n -= whole * bmp->channels;
+        col += whole * bmp->channels;
+        px += whole * bmp->pixel_bytes;
+
+        if (col == bmp->row_carriers)
+        {
+            col = 0;
+            px += bmp->stride - bmp->row_bytes;  // Skip the row padding
+        }
+    }
+}
+
+void bmp_gather(const BmpInfo *bmp, size_t pos, const unsigned char *raw, unsigned char *buf, size_t n)
+{
+    size_t col = pos % bmp->row_bytes;
+
+    if (bmp->channel_mask != 0)
+    {
+        channel_copy(bmp, pos, (unsigned char *)raw, buf, n, 0);  // raw is only read
+        return;
+    }
+
+    while (n > 0)
+    {
+        size_t len = bmp->row_bytes - col < n ? bmp->row_bytes - col : n;
+        memcpy(buf, raw, len);
+        buf += len;
+        n -= len;
+        raw += len + (bmp->stride - bmp->row_bytes);  // Skip the row padding
+        col = 0;
+    }
+}
+
+void bmp_scatter(const BmpInfo *bmp, size_t pos, unsigned char *raw, const unsigned char *buf, size_t n)
+{
+    size_t col = pos % bmp->row_bytes;
+
+    if (bmp->channel_mask != 0)
+    {
+        channel_copy(bmp, pos, raw, (unsigned char *)buf, n, 1);  // buf is only read
+        return;
+    }
+
+    while (n > 0)
+    {
+        size_t len = bmp->row_bytes - col < n ? bmp->row_bytes - col : n;
+        memcpy(raw, buf, len);
+        buf += len;
+        n -= len;
+        raw += len + (bmp->stride - bmp->row_bytes);
+        col = 0;
+    }
+}
+
+void pixel_iter_init(PixelIter *it, const BmpInfo *bmp, FILE *fptr_src, FILE *fptr_dest)
+{
+    it->bmp = bmp;
+    it->fptr_src = fptr_src;
+    it->fptr_dest = fptr_dest;
+    it->pl = NULL;
+    it->pos = 0;
+    it->file_pos = bmp->pixel_offset;
+    it->raw = NULL;
+    it->raw_size = 0;
+    it->span = 0;
+    it->span_pos = 0;
+}
+
+void pixel_iter_pipeline(PixelIter *it)
+{
+#ifndef _WIN32
+    struct stat st;
+
+    if (fstat(fileno(it->fptr_src), &st) != 0 || !S_ISREG(st.st_mode) ||
+        (it->fptr_dest != NULL && (fflush(it->fptr_dest) != 0 || fstat(fileno(it->fptr_dest), &st) != 0 ||
+                                   !S_ISREG(st.st_mode))))
+    {
+        LOG_INFO("INFO: Not a regular file, reading and writing the image without the pipeline\n");
+        return;
+    }
+    it->pl = pipeline_open(fileno(it->fptr_src), it->fptr_dest != NULL ? fileno(it->fptr_dest) : -1, it->file_pos);
+#endif
+}
+
+/* Next n source bytes */
+static Status iter_src_read(PixelIter *it, unsigned char *buf, size_t n)
+{
+    if (it->pl != NULL)
+    {
+        return pipeline_read(it->pl, buf, n);
+    }
+    return fread(buf, n, 1, it->fptr_src) == 1 ? e_success : e_failure;
+}
+
+/* Next n output bytes */
+static Status iter_dest_write(PixelIter *it, const unsigned char *buf, size_t n)
+{
+    if (n == 0)
+    {
+        return e_success;
+    }
+    if (it->pl != NULL)
+    {
+        return pipeline_write(it->pl, buf, n);
+    }
+    return fwrite(buf, n, 1, it->fptr_dest) == 1 ? e_success : e_failure;
+}
+
+Status pixel_iter_read(PixelIter *it, unsigned char *buf, size_t n)
+{
+    const BmpInfo *bmp = it->bmp;
+    size_t off, end;
+
+    if (n == 0)
+    {
+        return e_success;
+    }
+    if (n > bmp->carrier_size - it->pos)
+    {
+        fprintf(stderr, "ERROR: Image pixel data ended\n");
+        return e_failure;
+    }
+    off = bmp_carrier_offset(bmp, it->pos);
+    end = bmp_carrier_end(bmp, it->pos + n);
+
+    // Padding left over from the previous read goes straight through
+    while (it->file_pos < off)
+    {
+        unsigned char pad[64];
+        size_t len = off - it->file_pos < sizeof(pad) ? off - it->file_pos : sizeof(pad);
+
+        if (iter_src_read(it, pad, len) == e_failure ||
+            (it->fptr_dest != NULL && iter_dest_write(it, pad, len) == e_failure))
+        {
+            return e_failure;
+        }
+        it->file_pos += len;
+    }
+
+    if (bmp_is_contiguous(bmp))
+    {
+        // No padding, the carrier bytes are contiguous
+        if (iter_src_read(it, buf, n) == e_failure)
+        {
+            fprintf(stderr, "ERROR: Image pixel data ended\n");
+            return e_failure;
+        }
+    }
+    else
+    {
+        if (end - off > it->raw_size)
+        {
+            unsigned char *raw = realloc(it->raw, end - off);
+            if (raw == NULL)
+            {
+                fprintf(stderr, "ERROR: Out of memory\n");
+                return e_failure;
+            }
+            it->raw = raw;
+            it->raw_size = end - off;
+        }
+        if (iter_src_read(it, it->raw, end - off) == e_failure)
+        {
+            fprintf(stderr, "ERROR: Image pixel data ended\n");
+            return e_failure;
+        }
+        bmp_gather(bmp, it->pos, it->raw, buf, n);
+    }
+
+    it->span = end - off;
+    it->span_pos = it->pos;
+    it->file_pos = end;
+    it->pos += n;
+    return e_success;
+}
+
+Status pixel_iter_write(PixelIter *it, const unsigned char *buf, size_t n)
+{
+    if (bmp_is_contiguous(it->bmp))
+    {
+        return iter_dest_write(it, buf, n);
+    }
+
+    bmp_scatter(it->bmp, it->span_pos, it->raw, buf, n);
+    return iter_dest_write(it, it->raw, it->span);
+}
+
+Status pixel_iter_close(PixelIter *it)
+{
+    Status ret = e_success;
+
+#ifndef _WIN32
+    if (it->pl != NULL)
+    {
+        // Leave both streams where the stdio path would have
+        ret = pipeline_close(it->pl);
+        it->pl = NULL;
+        fseeko(it->fptr_src, it->file_pos, SEEK_SET);
+        if (it->fptr_dest != NULL)
+        {
+            fseeko(it->fptr_dest, it->file_pos, SEEK_SET);
+        }
+    }
+#endif
+    free(it->raw);
+    it->raw = NULL;
+    it->raw_size = 0;
+    return ret;
+}
@@ -0,0 +1,119 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef BMP_H
+#define BMP_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * BMP layout needed to walk the pixel array. The carrier is the pixel
+ * bytes of every row in file order; row padding is never part of it.
+ */
+typedef struct _BmpInfo
+{
+    size_t pixel_offset;    // bfOffBits, start of the pixel array
+    int width;
+    int height;             // Always positive, see top_down
+    int top_down;           // Rows stored top to bottom (negative height)
+    uint bits_per_pixel;    // 24 or 32
+    size_t row_bytes;       // Pixel bytes per row, all of them carrier bytes
+    size_t stride;          // Row size in the file including padding
+    size_t carrier_size;    // row_bytes * height, see bmp_set_channels for a channel mask
+    size_t file_size;
+    uint channel_mask;      // Carrier channels of each pixel from channel_base on, 0 for every byte
+    size_t channel_base;    // Carrier position where the channel mask starts
+    uint channels;          // Channels in channel_mask
+    uint pixel_bytes;       // 3 or 4
+    unsigned char channel_offset[4];            // Byte of each carrier channel in its pixel
+    size_t row_carriers;    // Carrier bytes per row under the channel mask
+    const struct _ChannelKernels *kernels;     // Picked for pixel_bytes and channel_mask
+} BmpInfo;
+
+/* Parse the BMP headers at the start of data; on failure steg_last_error() says why */
+Status parse_bmp_info(const unsigned char *data, size_t size, size_t file_size, BmpInfo *bmp);
+
+/* Read and parse the BMP headers of an open file; leaves the file position undefined */
+Status read_bmp_info(FILE *fptr, BmpInfo *bmp);
+
+/* Treat everything after the 54 byte header as one row, as images written before row parsing expect */
+void bmp_set_raw_layout(BmpInfo *bmp);
+
+/* True when the parsed layout already matches bmp_set_raw_layout for every carrier byte */
+int bmp_is_raw_layout(const BmpInfo *bmp);
+
+/*
+ * Channel masks pick which bytes of each pixel are carrier bytes: bit 0 is
+ * the first byte in the file (blue), then green, red and alpha. A mask that
+ * names a channel the pixels lack fails; one that names every channel is
+ * returned as 0.
+ */
+Status bmp_check_channels(const BmpInfo *bmp, uint *mask);
+
+/*
+ * Narrow the carrier to the channels in mask from carrier position pos on.
+ * The narrowed carrier starts on the first row that holds no carrier byte
+ * before pos. Positions carry on from pos, so a cursor stays where it was.
+ */
+Status bmp_set_channels(BmpInfo *bmp, size_t pos, uint mask);
+
+/* True when the carrier bytes are one run of file bytes, without padding or skipped channels */
+int bmp_is_contiguous(const BmpInfo *bmp);
+
+/* File offset of carrier byte pos */
+size_t bmp_carrier_offset(const BmpInfo *bmp, size_t pos);
+
+/* File offset just past carrier byte pos - 1 (the pixel offset when pos is 0) */
+size_t bmp_carrier_end(const BmpInfo *bmp, size_t pos);
+
+/* Copy n carrier bytes out of raw, which holds the file bytes from carrier byte pos on */
+void bmp_gather(const BmpInfo *bmp, size_t pos, const unsigned char *raw, unsigned char *buf, size_t n);
+
+/* Inverse of bmp_gather; padding bytes in raw are left alone */
+void bmp_scatter(const BmpInfo *bmp, size_t pos, unsigned char *raw, const unsigned char *buf, size_t n);
+
+/*
+ * Sequential carrier reader/writer over stdio streams. Scanlines are read
+ * into a small reusable buffer and padding bytes are copied through to the
+ * output untouched. When encoding, every pixel_iter_read is followed by a
+ * pixel_iter_write of the same bytes.
+ */
+typedef struct _PixelIter
+{
+    const BmpInfo *bmp;
+    FILE *fptr_src;
+    FILE *fptr_dest;        // NULL when decoding
+    struct _Pipeline *pl;   // Overlapped I/O in place of the streams, see pixel_iter_pipeline
+    size_t pos;             // Carrier bytes read so far
+    size_t file_pos;        // File offset of the next unread source byte
+    unsigned char *raw;     // File bytes of the last read, for padded rows
+    size_t raw_size;
+    size_t span;            // Bytes of raw in use
+    size_t span_pos;        // Carrier position of the last read
+} PixelIter;
+
+/* Start at the pixel array; the source must be positioned at bmp->pixel_offset */
+void pixel_iter_init(PixelIter *it, const BmpInfo *bmp, FILE *fptr_src, FILE *fptr_dest);
+
+/* Read the next n carrier bytes into buf */
+Status pixel_iter_read(PixelIter *it, unsigned char *buf, size_t n);
+
+/* Write back the n bytes returned by the last pixel_iter_read */
+Status pixel_iter_write(PixelIter *it, const unsigned char *buf, size_t n);
+
+/*
+ * Read ahead and write behind on I/O threads (pipeline.h) from here on;
+ * the streams are flushed first and moved past the last byte at
+ * pixel_iter_close. Streams that are not regular files stay as they are.
+ */
+void pixel_iter_pipeline(PixelIter *it);
+
+/* Fails only when overlapped writes failed */
+Status pixel_iter_close(PixelIter *it);
+
+#endif
@@ -0,0 +1,516 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lsb_steg.h"
+#include "parallel.h"
+#include "encode.h"
+
+/* Headers are read from disk, so run more workers than CPUs */
+#define CATALOG_WORKERS_PER_CPU 4
+
+/* Longest magic string, it is read after the carrier is picked */
+#define PICK_MAGIC_LEN 9
+
+typedef struct _CatalogItem
+{
+    char *path;
+    CatalogEntry entry;
+    int valid;                      // entry describes a usable BMP
+} CatalogItem;
+
+/* A mapped index file */
+typedef struct _CatalogMap
+{
+    void *addr;
+    size_t size;
+    const CatalogHeader *hdr;
+    const CatalogEntry *entries;
+    const char *strings;
+} CatalogMap;
+
+typedef struct _Catalog
+{
+    CatalogItem *items;
+    size_t nitems;
+    size_t cap;
+    CatalogMap old;                 // Index being updated, addr is NULL when there is none
+    const CatalogEntry **by_path;   // Its records sorted by path
+    size_t *stale;                  // Items whose header has to be read
+    size_t nstale;
+} Catalog;
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Map and check an index file; quiet when it does not exist */
+static Status map_catalog(const char *index_fname, CatalogMap *map)
+{
+    struct stat st;
+    int fd = open(index_fname, O_RDONLY | O_CLOEXEC);
+
+    memset(map, 0, sizeof(*map));
+    if (fd < 0)
+    {
+        return e_failure;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CatalogHeader))
+    {
+        close(fd);
+        fprintf(stderr, "ERROR: %s is not a carrier catalog\n", index_fname);
+        return e_failure;
+    }
+    map->size = st.st_size;
+    map->addr = mmap(NULL, map->size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map->addr == MAP_FAILED)
+    {
+        perror("mmap");
+        map->addr = NULL;
+        return e_failure;
+    }
+
+    map->hdr = map->addr;
+    map->entries = (const CatalogEntry *)(map->hdr + 1);
+    map->strings = (const char *)(map->entries + map->hdr->count);
+    if (memcmp(map->hdr->magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0 ||
+        map->hdr->count > (map->size - sizeof(CatalogHeader)) / sizeof(CatalogEntry) ||
+        sizeof(CatalogHeader) + map->hdr->count * sizeof(CatalogEntry) + map->hdr->strings_size != map->size ||
+        (map->hdr->strings_size > 0 && map->strings[map->hdr->strings_size - 1] != '\0'))
+    {
+        fprintf(stderr, "ERROR: %s is not a carrier catalog\n", index_fname);
+        munmap(map->addr, map->size);
+        map->addr = NULL;
+        return e_failure;
+    }
+    for (uint i = 0; i < map->hdr->count; i++)
+    {
+        if (map->entries[i].path >= map->hdr->strings_size)
+        {
+            fprintf(stderr, "ERROR: %s is not a carrier catalog\n", index_fname);
+            munmap(map->addr, map->size);
+            map->addr = NULL;
+            return e_failure;
+        }
+    }
+    return e_success;
+}
+
+static const char *old_path(const Catalog *cat, const CatalogEntry *entry)
+{
+    return cat->old.strings + entry->path;
+}
+
+static const Catalog *sort_catalog;     // qsort has no context argument
+
+static int cmp_old_path(const void *a, const void *b)
+{
+    return strcmp(old_path(sort_catalog, *(const CatalogEntry *const *)a),
+                  old_path(sort_catalog, *(const CatalogEntry *const *)b));
+}
+
+static int cmp_carrier_size(const void *a, const void *b)
+{
+    const CatalogItem *x = a, *y = b;
+    return x->entry.carrier_size < y->entry.carrier_size ? -1 : x->entry.carrier_size > y->entry.carrier_size;
+}
+
+/* Record the file, reusing its old record when the size and mtime still match */
+static void add_file(Catalog *cat, const char *path, const struct stat *st)
+{
+    CatalogItem *item;
+
+    if (cat->nitems == cat->cap)
+    {
+        size_t cap = cat->cap ? 2 * cat->cap : 256;
+        CatalogItem *grown = realloc(cat->items, cap * sizeof(*grown));
+        if (grown == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory, skipping %s\n", path);
+            return;
+        }
+        cat->items = grown;
+        cat->cap = cap;
+    }
+    item = &cat->items[cat->nitems];
+    item->path = strdup(path);
+    if (item->path == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory, skipping %s\n", path);
+        return;
+    }
+    memset(&item->entry, 0, sizeof(item->entry));
+    item->entry.file_size = st->st_size;
+    item->entry.mtime_sec = st->st_mtim.tv_sec;
+    item->entry.mtime_nsec = st->st_mtim.tv_nsec;
+    item->valid = 0;
+
+    if (cat->old.addr != NULL)
+    {
+        const CatalogEntry **found;
+        size_t lo = 0, hi = cat->old.hdr->count;
+
+        // Binary search of the old records by path
+        while (lo < hi)
+        {
+            size_t mid = (lo + hi) / 2;
+            int cmp = strcmp(old_path(cat, cat->by_path[mid]), path);
+            if (cmp < 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        found = lo < cat->old.hdr->count && strcmp(old_path(cat, cat->by_path[lo]), path) == 0 ? &cat->by_path[lo] : NULL;
+        if (found != NULL && (*found)->file_size == item->entry.file_size &&
+            (*found)->mtime_sec == item->entry.mtime_sec && (*found)->mtime_nsec == item->entry.mtime_nsec)
+        {
+            item->entry = **found;
+            item->valid = 1;
+        }
+    }
+    cat->nitems++;
+}
+
+static int is_bmp_name(const char *name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".bmp") == 0;
+}
+
+/* Add every .bmp file under path; symlinks to directories are not followed */
+static void walk_dir(Catalog *cat, const char *path)
+{
+    struct dirent *ent;
+    DIR *dir = opendir(path);
+
+    if (dir == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to open directory %s\n", path);
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL)
+    {
+        struct stat st;
+        char *child;
+
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0 ||
+            (ent->d_type != DT_DIR && ent->d_type != DT_UNKNOWN && !is_bmp_name(ent->d_name)))
+        {
+            continue;
+        }
+        child = malloc(strlen(path) + strlen(ent->d_name) + 2);
+        if (child == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            break;
+        }
+        sprintf(child, "%s/%s", path, ent->d_name);
+        if (lstat(child, &st) == 0)
+        {
+            if (S_ISDIR(st.st_mode))
+            {
+                walk_dir(cat, child);
+            }
+            else if (S_ISREG(st.st_mode) && is_bmp_name(ent->d_name))
+            {
+                add_file(cat, child, &st);
+            }
+        }
+        free(child);
+    }
+    closedir(dir);
+}
+
+/* Read the BMP header of one changed or new file */
+static void read_header_job(size_t job, void *arg)
+{
+    Catalog *cat = arg;
+    CatalogItem *item = &cat->items[cat->stale[job]];
+    unsigned char head[BMP_HEADER_SIZE];
+    BmpInfo bmp;
+    int fd = open(item->path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return;
+    }
+    if (pread(fd, head, sizeof(head), 0) == sizeof(head) &&
+        parse_bmp_info(head, sizeof(head), item->entry.file_size, &bmp) == e_success)
+    {
+        item->entry.carrier_size = bmp.carrier_size;
+        item->entry.width = bmp.width;
+        item->entry.height = bmp.top_down ? -bmp.height : bmp.height;
+        item->entry.bits_per_pixel = bmp.bits_per_pixel;
+        item->valid = 1;
+    }
+    close(fd);
+}
+
+/* Write the records sorted by carrier bytes next to the index, then move it into place */
+static Status write_catalog(const char *index_fname, Catalog *cat, size_t *written)
+{
+    CatalogHeader hdr;
+    char *tmp_fname = malloc(strlen(index_fname) + 5);
+    size_t strings_size = 0, n = 0;
+    FILE *fptr;
+    Status ret = e_success;
+
+    if (tmp_fname == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    // Drop the files that are not usable BMPs
+    for (size_t i = 0; i < cat->nitems; i++)
+    {
+        if (cat->items[i].valid)
+        {
+            cat->items[n++] = cat->items[i];
+        }
+        else
+        {
+            free(cat->items[i].path);
+        }
+    }
+    cat->nitems = n;
+    qsort(cat->items, cat->nitems, sizeof(CatalogItem), cmp_carrier_size);
+
+    for (size_t i = 0; i < cat->nitems; i++)
+    {
+        cat->items[i].entry.path = strings_size;
+        strings_size += strlen(cat->items[i].path) + 1;
+    }
+    if (cat->nitems > UINT_MAX || strings_size > UINT_MAX)
+    {
+        fprintf(stderr, "ERROR: Too many carriers for one catalog\n");
+        free(tmp_fname);
+        return e_failure;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    hdr.count = cat->nitems;
+    hdr.strings_size = strings_size;
+
+    sprintf(tmp_fname, "%s.tmp", index_fname);
+    fptr = fopen(tmp_fname, "wb");
+    if (fptr == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", tmp_fname);
+        free(tmp_fname);
+        return e_failure;
+    }
+    fwrite(&hdr, sizeof(hdr), 1, fptr);
+    for (size_t i = 0; i < cat->nitems; i++)
+    {
+        fwrite(&cat->items[i].entry, sizeof(CatalogEntry), 1, fptr);
+    }
+    for (size_t i = 0; i < cat->nitems; i++)
+    {
+        fwrite(cat->items[i].path, strlen(cat->items[i].path) + 1, 1, fptr);
+    }
+    // Readers see either the old index or the whole new one
+    if (ferror(fptr) || fclose(fptr) != 0 || rename(tmp_fname, index_fname) != 0)
+    {
+        perror("write");
+        fprintf(stderr, "ERROR: Unable to write %s\n", index_fname);
+        unlink(tmp_fname);
+        ret = e_failure;
+    }
+    *written = cat->nitems;
+    free(tmp_fname);
+    return ret;
+}
+
+Status do_catalog(const char *index_fname, char *paths[], int npaths, const StegOptions *opts)
+{
+    Catalog cat;
+    int nworkers = opts->num_threads;
+    size_t written = 0;
+    double start = get_time_sec();
+    Status ret = e_failure;
+
+    memset(&cat, 0, sizeof(cat));
+    if (map_catalog(index_fname, &cat.old) == e_success)
+    {
+        cat.by_path = malloc((cat.old.hdr->count > 0 ? cat.old.hdr->count : 1) * sizeof(*cat.by_path));
+        if (cat.by_path == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            goto done;
+        }
+        for (uint i = 0; i < cat.old.hdr->count; i++)
+        {
+            cat.by_path[i] = &cat.old.entries[i];
+        }
+        sort_catalog = &cat;
+        qsort(cat.by_path, cat.old.hdr->count, sizeof(*cat.by_path), cmp_old_path);
+    }
+    else if (access(index_fname, F_OK) == 0)
+    {
+        goto done;  // Something other than an index, never overwrite it
+    }
+
+    // Paths are stored absolute so the catalog works from any directory
+    for (int i = 0; i < npaths; i++)
+    {
+        char *real = realpath(paths[i], NULL);
+        struct stat st;
+
+        if (real == NULL || stat(real, &st) != 0)
+        {
+            fprintf(stderr, "ERROR: Unable to open %s\n", paths[i]);
+        }
+        else if (S_ISDIR(st.st_mode))
+        {
+            walk_dir(&cat, real);
+        }
+        else
+        {
+            add_file(&cat, real, &st);
+        }
+        free(real);
+    }
+
+    cat.stale = malloc((cat.nitems > 0 ? cat.nitems : 1) * sizeof(*cat.stale));
+    if (cat.stale == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        goto done;
+    }
+    for (size_t i = 0; i < cat.nitems; i++)
+    {
+        if (!cat.items[i].valid)
+        {
+            cat.stale[cat.nstale++] = i;
+        }
+    }
+    if (nworkers < 1)
+    {
+        nworkers = sysconf(_SC_NPROCESSORS_ONLN) * CATALOG_WORKERS_PER_CPU;
+    }
+    if (run_parallel(nworkers, cat.nstale, read_header_job, &cat) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto done;
+    }
+
+    ret = write_catalog(index_fname, &cat, &written);
+    if (ret == e_success)
+    {
+        LOG_INFO("INFO: %zu carriers in %s, %zu headers read, %.3f s\n", written, index_fname, cat.nstale,
+                 get_time_sec() - start);
+    }
+
+done:
+    for (size_t i = 0; i < cat.nitems; i++)
+    {
+        free(cat.items[i].path);
+    }
+    free(cat.items);
+    free(cat.stale);
+    free(cat.by_path);
+    if (cat.old.addr != NULL)
+    {
+        munmap(cat.old.addr, cat.old.size);
+    }
+    return ret;
+}
+
+Status catalog_pick(const char *index_fname, const char *secret_fname, const StegOptions *opts,
+                    char *path, size_t path_size)
+{
+    CatalogMap map;
+    struct stat st;
+    size_t extn_len = strlen(secret_file_extn(secret_fname));
+    size_t lo = 0, hi;
+
+    if (opts->channel_mask != 0)
+    {
+        fprintf(stderr, "ERROR: --channels cannot be used with --pick\n");  // The catalog is ordered by whole-pixel capacity
+        return e_failure;
+    }
+    if (stat(secret_fname, &st) != 0)
+    {
+        perror("stat");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", secret_fname);
+        return e_failure;
+    }
+    if (map_catalog(index_fname, &map) == e_failure)
+    {
+        if (map.addr == NULL && access(index_fname, F_OK) != 0)
+        {
+            fprintf(stderr, "ERROR: Unable to open file %s\n", index_fname);
+        }
+        return e_failure;
+    }
+
+    // Smallest carrier_size whose capacity holds the secret
+    hi = map.hdr->count;
+    while (lo < hi)
+    {
+        size_t mid = (lo + hi) / 2;
+        if (steg_capacity(map.entries[mid].carrier_size, PICK_MAGIC_LEN, extn_len, opts, 0) >= (size_t)st.st_size)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    if (lo == map.hdr->count || strlen(map.strings + map.entries[lo].path) >= path_size)
+    {
+        fprintf(stderr, "ERROR: No carrier in %s holds %lld bytes\n", index_fname, (long long)st.st_size);
+        munmap(map.addr, map.size);
+        return e_failure;
+    }
+    strcpy(path, map.strings + map.entries[lo].path);
+    LOG_INFO("INFO: Picked %s, %dx%d at %u bpp\n", path, map.entries[lo].width,
+             abs(map.entries[lo].height), map.entries[lo].bits_per_pixel);
+    munmap(map.addr, map.size);
+    return e_success;
+}
+
+#else
+
+Status do_catalog(const char *index_fname, char *paths[], int npaths, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Catalog mode is not supported on this platform\n");
+    return e_failure;
+}
+
+Status catalog_pick(const char *index_fname, const char *secret_fname, const StegOptions *opts,
+                    char *path, size_t path_size)
+{
+    fprintf(stderr, "ERROR: Catalog mode is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Carrier catalog: an index of every BMP in a carrier pool with its exact
+ * carrier bytes, bpp and dimensions, so a carrier can be picked for a
+ * secret without opening any image. Building it reads only the BMP
+ * headers, and an update re-reads only files whose size or mtime changed.
+ *
+ * The index file, in host byte order, is a CatalogHeader, then count
+ * CatalogEntry records sorted by carrier_size, then the NUL terminated
+ * paths the records point into. Capacity only grows with carrier bytes,
+ * so the smallest carrier that fits is found by binary search over the
+ * mapped records.
+ */
+
+#define CATALOG_MAGIC "LSBCAT1"
+
+typedef struct _CatalogHeader
+{
+    char magic[8];                      // CATALOG_MAGIC
+    uint count;                         // Records
+    uint strings_size;                  // Bytes of paths after the records
+} CatalogHeader;
+
+typedef struct _CatalogEntry
+{
+    unsigned long long carrier_size;    // Pixel bytes that can hold data, see BmpInfo
+    unsigned long long file_size;
+    long long mtime_sec;
+    long long mtime_nsec;
+    int width;
+    int height;                         // Negative for top-down images
+    uint bits_per_pixel;
+    uint path;                          // Offset of the absolute path in the strings
+} CatalogEntry;
+
+/* Build or update index_fname from the BMPs under paths */
+Status do_catalog(const char *index_fname, char *paths[], int npaths, const StegOptions *opts);
+
+/* Pick the smallest carrier in index_fname that holds secret_fname with these options */
+Status catalog_pick(const char *index_fname, const char *secret_fname, const StegOptions *opts,
+                    char *path, size_t path_size);
+
+#endif
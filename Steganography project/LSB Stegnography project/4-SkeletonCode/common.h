@@ -4,4 +4,38 @@
 /* Magic string to identify whether stegged or not */
 #define MAGIC_STRING "#*#"
 
+/*
+ * Stego header: the magic string length word carries the header version
+ * in bits 8-15 (0 for images written before versioning). From version 1
+ * a format word follows the magic string. Both are stored 1 bit per byte;
+ * everything after the format word uses the depth it records. Version 2
+ * skips BMP row padding; older images used every byte after the 54 byte
+ * header. Version 3 stores the sizes (secret data length, shard offset and
+ * total size, archive data length) as 64-bit words; every other word,
+ * and every size in older images, is 32 bits.
+ */
+#define STEG_HEADER_VERSION 3
+#define STEG_ROW_LAYOUT_VERSION 2
+#define STEG_WIDE_VERSION 3
+#define STEG_SIZE_BYTES 8       // Bytes of a size word from STEG_WIDE_VERSION on
+#define FORMAT_DEPTH_MASK 0xF   // LSB depth in bits 0-3 of the format word
+#define MAX_LSB_DEPTH 4
+#define FORMAT_CODEC_SHIFT 4    // Secret data codec in bits 4-7 of the format word
+#define FORMAT_CODEC_MASK 0xF0
+#define CODEC_NONE 0
+#define CODEC_LZ 1              // LZ blocks, see lz_codec.h
+#define FORMAT_CRC 0x100        // A CRC32C of the secret data follows it, see crc32c.h
+#define FORMAT_SHARD 0x200      // Shard words follow the format word, see shard.h
+#define STEG_SHARD_WORDS 2      // Set id, index | count << 16, then the offset and total size words
+#define FORMAT_ARCHIVE 0x400    // A table of contents of several files replaces the extension, see archive.h
+#define FORMAT_CHANNEL_SHIFT 12 // Carrier channel mask in bits 12-15 of the format word, see bmp_set_channels
+#define FORMAT_CHANNEL_MASK 0xF000
+
+/* Size of the BMP file header plus info header */
+#define BMP_HEADER_SIZE 54
+
+/* Secret data is streamed through these buffers chunk by chunk */
+#define MAX_SECRET_BUF_SIZE 16384
+#define MAX_IMAGE_BUF_SIZE (MAX_SECRET_BUF_SIZE * 8)
+
 #endif
@@ -0,0 +1,177 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "crc32c.h"
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define CRC32C_X86
+#include <immintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78u  // Reflected Castagnoli polynomial
+
+static uint32_t crc_table[8][256];
+static int crc_table_ready;
+
+/* Fill in the slice-by-8 tables: table[k][b] is b followed by k zero bytes */
+static void crc32c_init_tables(void)
+{
+    for (int b = 0; b < 256; b++)
+    {
+        uint32_t crc = b;
+        for (int i = 0; i < 8; i++)
+        {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+        }
+        crc_table[0][b] = crc;
+    }
+    for (int b = 0; b < 256; b++)
+    {
+        for (int k = 1; k < 8; k++)
+        {
+            crc_table[k][b] = (crc_table[k - 1][b] >> 8) ^ crc_table[0][crc_table[k - 1][b] & 0xFF];
+        }
+    }
+    __atomic_store_n(&crc_table_ready, 1, __ATOMIC_RELEASE);  // Tables are complete before anyone sees the flag
+}
+
+static uint32_t crc32c_slice8(uint32_t crc, const unsigned char *p, size_t len)
+{
+    if (!__atomic_load_n(&crc_table_ready, __ATOMIC_ACQUIRE))
+    {
+        crc32c_init_tables();  // Racing threads write the same values
+    }
+
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+    }
+    for (; len > 0; p++, len--)
+    {
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *p) & 0xFF];
+    }
+    return crc;
+}
+
+#ifdef CRC32C_X86
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t len)
+{
+    uint64_t crc64 = crc;
+
+    for (; len >= 8; p += 8, len -= 8)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc64 = _mm_crc32_u64(crc64, v);
+    }
+    crc = crc64;
+    for (; len > 0; p++, len--)
+    {
+        crc = _mm_crc32_u8(crc, *p);
+    }
+    return crc;
+}
+
+static int sse42_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+#endif
+
+/* -1 until the first call checks the CPU; slab workers may race to set it */
+static int use_sse42 = -1;
+
+#ifdef CRC32C_X86
+static int crc32c_use_sse42(void)
+{
+    int use = __atomic_load_n(&use_sse42, __ATOMIC_RELAXED);
+
+    if (use < 0)
+    {
+        use = sse42_supported();
+        __atomic_store_n(&use_sse42, use, __ATOMIC_RELAXED);
+    }
+    return use;
+}
+#endif
+
+uint crc32c_update(uint crc, const void *data, size_t len)
+{
+#ifdef CRC32C_X86
+    if (crc32c_use_sse42())
+    {
+        return ~crc32c_sse42(~crc, data, len);
+    }
+#endif
+    return ~crc32c_slice8(~crc, data, len);
+}
+
+/*
+ * a * b modulo the polynomial, both bit-reflected like the CRC itself,
+ * so bit 31 is x^0. a must not be 0.
+ */
+static uint32_t crc32c_multmodp(uint32_t a, uint32_t b)
+{
+    uint32_t m = 1u << 31, p = 0;
+
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+            {
+                break;
+            }
+        }
+        m >>= 1;
+        b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+    }
+    return p;
+}
+
+uint crc32c_combine(uint crc1, uint crc2, size_t len2)
+{
+    uint32_t op = 1u << 31;      // x^0
+    uint32_t square = 1u << 23;  // x^8, one zero byte
+
+    // Appending len2 zero bytes to A multiplies its CRC by x^(8 * len2)
+    for (; len2 != 0; len2 >>= 1)
+    {
+        if (len2 & 1)
+        {
+            op = crc32c_multmodp(square, op);
+        }
+        square = crc32c_multmodp(square, square);
+    }
+    return crc32c_multmodp(op, crc1) ^ crc2;
+}
+
+const char *crc32c_impl_name(void)
+{
+#ifdef CRC32C_X86
+    if (crc32c_use_sse42())
+    {
+        return "sse4.2";
+    }
+#endif
+    return "slice8";
+}
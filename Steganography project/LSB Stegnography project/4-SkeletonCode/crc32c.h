@@ -0,0 +1,28 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * CRC32C (Castagnoli) of the secret data, stored after the data when the
+ * format word has FORMAT_CRC. Uses the SSE4.2 crc32 instruction when the
+ * CPU has it and slice-by-8 tables otherwise; both give the same value.
+ */
+
+/* Continue crc over len more bytes; start with 0 */
+uint crc32c_update(uint crc, const void *data, size_t len);
+
+/* CRC of A followed by B, from crc1 of A, crc2 of B and the length of B */
+uint crc32c_combine(uint crc1, uint crc2, size_t len2);
+
+/* "sse4.2" or "slice8", the implementation crc32c_update uses */
+const char *crc32c_impl_name(void);
+
+#endif
@@ -1,181 +1,390 @@
-/*
-Name : Sharan
-Date : 20/10/2024
-Description : Implementation of LSB image Steganography project
-*/
-
-
-#include <stdio.h>
-#include "decode.h"
-#include "types.h"
-#include "common.h"
-#include <string.h>
-
-Status do_decoding(DecodeInfo *decInfo)                 
-{
-    // Open the necessary files for decoding (stego image and secret output file)
-    open_file(decInfo);
-    printf("INFO: Opened required files\n");
-
-    // Skip the BMP header (first 54 bytes) in the stego image
-    skip_header(decInfo->fptr_stego_image);
-    printf("INFO: Skipped BMP header\n");
-
-    // Decode the magic string
-    if (decode_magic_string(decInfo) == e_failure)
-    {
-        return e_failure;  
-    }
-    printf("INFO: Magic String decoded successfully\n");       
-
-    // Decode the secret file extension 
-    decode_secret_file_extn(decInfo);
-    printf("INFO: Output File Extension decoded successfully\n");
-
-    // Data decoded  from the stego image
-    decode_secret_file_data(decInfo);
-    printf("INFO: Data decoded successfully and copied to file\n");
-
-    return e_success;
-}
-
-Status open_file(DecodeInfo *decInfo)    // opening the required files                  
-{
-    decInfo->fptr_stego_image = fopen(decInfo->stego_image_fname, "rb");
-    
-    if (decInfo->fptr_stego_image == NULL)
-    {
-        perror("fopen");
-        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->stego_image_fname);
-        return e_failure;
-    }
-    else
-    {
-        printf("INFO : %s file open\n", decInfo->stego_image_fname);
-    }
-    
-    return e_success;
-}
-
-Status skip_header(FILE *fptr)                      
-{
-    fseek(fptr, 54, SEEK_SET);  // Skip the first 54 bytes of the BMP file (header)
-    return e_success;
-}
-
-
-Status decode_secret_file_extn(DecodeInfo *decInfo)     // Decode secrete file extension        
-{
-    int len = decode_len(decInfo);
-
-    char str[len + 1];  
-    decode_string(len, str, decInfo);
-
-    strcat(decInfo->secret_fname, str);
-
-    return e_success;
-}
-
-Status decode_secret_file_data(DecodeInfo *decInfo)     
-{
-    
-    int len = decode_len(decInfo);
-
-    char str[len + 1];  // Buffer to store the decoded secret data
-    decode_string(len, str, decInfo);
-
-    add_secrate_data_to_file(str, decInfo);
-
-    return e_success;
-}
-
-Status decode_magic_string(DecodeInfo *decInfo)             
-{
-    
-    int len = decode_len(decInfo);  // Decode the length of the magic string
-
-    if (len >= 10)
-    {
-        printf("Magic String not matching!\n");
-        return e_failure;
-    }
-
-    char str[len + 1];  // +1 for  the null character
-
-    decode_string(len, str, decInfo);
-
-    // Compare the decoded string with the expected magic string
-    if (strcmp(str, decInfo->magic_string) != 0)
-    {
-        printf("Magic String not matching!\n");
-        return e_failure;
-    }
-
-    return e_success;
-}
-
-int decode_len(DecodeInfo *decInfo)         // Decode the string length    
-{
-    int i, len = 0;
-    char buffer[32];  
-
-    fread(buffer, 32, 1, decInfo->fptr_stego_image);
-
-    // Extract the length from LSB of each byte
-    for (i = 0; i < 32; i++)
-    {
-        if (buffer[i] & 1)
-        {
-            len = (1 << i) | len;  // Set the corresponding bit in the length
-        }
-    }
-
-    return len;  // Return the decoded length
-}
-
-Status decode_string(int len, char str[], DecodeInfo *decInfo)      // Decode the string          
-{
-    int i, j, k = 0;
-    char buffer[8 * len];  
-
-    fread(buffer, 8 * len, 1, decInfo->fptr_stego_image);
-
-    // Decode each character by extracting its bits
-    for (i = 0; i < len; i++)
-    {
-        str[i] = 0;  
-        for (j = 0; j < 8; j++)
-        {
-            if (buffer[k] & 1)
-            {
-                str[i] = (1 << j) | str[i];  
-            }
-            k++;
-        }
-    }
-    str[i] = '\0';  // Null-terminate the decoded string
-
-    return e_success;
-}
-
-Status add_secrate_data_to_file(char str[], DecodeInfo *decInfo)             
-{
-    // Open the secret file for writing
-    decInfo->fptr_secret = fopen(decInfo->secret_fname, "w");
-    
-    if (decInfo->fptr_secret == NULL)
-    {
-        perror("fopen");
-        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
-        return e_failure;
-    }
-    else
-    {
-        printf("INFO : %s file open\n", decInfo->secret_fname);
-    }
-
-    // Write the decoded secret data to the file
-    fprintf(decInfo->fptr_secret, "%s", str);
-
-    return e_success;
-}
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+
+#include <stdio.h>
+#include "decode.h"
+#include "types.h"
+#include "common.h"
+#include <string.h>
+#include "lsb_kernel.h"
+#include "stream.h"
+
+/* End the open --stats phase and start the next one, counting I/O from the stream positions */
+static void decode_phase(DecodeInfo *decInfo, const char *name)
+{
+    if (decInfo->stats != NULL)
+    {
+        stats_phase(decInfo->stats, name,
+                    decInfo->iter.pl != NULL ? (long long)decInfo->iter.file_pos : ftello(decInfo->fptr_stego_image),
+                    decInfo->fptr_secret != NULL ? ftello(decInfo->fptr_secret) : 0, decInfo->iter.pos);
+    }
+}
+
+Status do_decoding(DecodeInfo *decInfo)                 
+{
+    // Open the necessary files for decoding (stego image and secret output file)
+    if (open_file(decInfo) == e_failure)
+    {
+        return e_failure;
+    }
+    LOG_INFO("INFO: Opened required files\n");
+    decInfo->iter.pos = 0;
+    decInfo->iter.pl = NULL;
+
+    // Parse the headers to find where the pixel rows are
+    decode_phase(decInfo, "header");
+    if (read_bmp_info(decInfo->fptr_stego_image, &decInfo->bmp) == e_failure)
+    {
+        return e_failure;
+    }
+
+    // Decode the magic string
+    decode_phase(decInfo, "magic");
+    Status ret = decode_magic_string(decInfo);
+    if ((ret == e_failure || decInfo->header_version < STEG_ROW_LAYOUT_VERSION) && !bmp_is_raw_layout(&decInfo->bmp))
+    {
+        // Older images used every byte after a 54 byte header, padding included
+        pixel_iter_close(&decInfo->iter);
+        bmp_set_raw_layout(&decInfo->bmp);
+        ret = decode_magic_string(decInfo);
+    }
+    if (ret == e_failure)
+    {
+        printf("Magic String not matching!\n");
+        pixel_iter_close(&decInfo->iter);
+        return e_failure;  
+    }
+    LOG_INFO("INFO: Magic String decoded successfully\n");       
+
+    // Decode the format word, which sets the LSB depth for the rest
+    ret = decode_header_format(decInfo);
+
+    // Decode the secret file extension and the data
+    if (ret == e_success)
+    {
+        LOG_INFO("INFO: Header format decoded successfully (%d bit LSB depth)\n", decInfo->lsb_depth);
+        decode_phase(decInfo, "extn");
+        ret = decode_secret_file_extn(decInfo);
+    }
+    if (ret == e_success)
+    {
+        LOG_INFO("INFO: Output File Extension decoded successfully\n");
+        decode_phase(decInfo, "data");
+        ret = decode_secret_file_data(decInfo);
+        decode_phase(decInfo, NULL);
+    }
+    pixel_iter_close(&decInfo->iter);
+    if (ret == e_failure)
+    {
+        return e_failure;
+    }
+    LOG_INFO("INFO: Data decoded successfully and copied to file\n");
+
+    return e_success;
+}
+
+Status open_file(DecodeInfo *decInfo)    // opening the required files                  
+{
+    decInfo->fptr_stego_image = stream_open(decInfo->stego_image_fname, "rb");
+    
+    if (decInfo->fptr_stego_image == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+    else
+    {
+        LOG_INFO("INFO : %s file open\n", decInfo->stego_image_fname);
+    }
+    
+    return e_success;
+}
+
+Status skip_header(FILE *fptr, size_t offset)                      
+{
+    fseeko(fptr, offset, SEEK_SET);  // Skip the BMP headers up to the pixel array
+    return e_success;
+}
+
+
+Status decode_secret_file_extn(DecodeInfo *decInfo)     // Decode secrete file extension        
+{
+    int len = decode_len(decInfo);
+
+    if (len < 0 || len >= (int)(sizeof(decInfo->secret_fname) - strlen(decInfo->secret_fname)))
+    {
+        fprintf(stderr, "ERROR: Invalid secret file extension\n");
+        return e_failure;
+    }
+
+    char str[len + 1];  
+    if (decode_string(len, str, decInfo) == e_failure)
+    {
+        return e_failure;
+    }
+
+    if (!stream_is_std(decInfo->secret_fname))
+    {
+        strcat(decInfo->secret_fname, str);  // Data written to stdout needs no name
+    }
+
+    return e_success;
+}
+
+/* Decode the next LZ block into secret_data, which must come out as len bytes */
+static Status decode_lz_block(int len, DecodeInfo *decInfo)
+{
+    uint word = decode_len(decInfo);
+    int size = word & ~LZ_BLOCK_RAW;
+
+    if (word & LZ_BLOCK_RAW)
+    {
+        if (size != len)
+        {
+            fprintf(stderr, "ERROR: Corrupt compressed block\n");
+            return e_failure;
+        }
+        return decode_string(size, decInfo->secret_data, decInfo);  // Block stored as is
+    }
+
+    if (size > LZ_BLOCK_SIZE || decode_string(size, decInfo->lz_data, decInfo) == e_failure ||
+        lz_decompress_block((const unsigned char *)decInfo->lz_data, size,
+                            (unsigned char *)decInfo->secret_data, len) != len)
+    {
+        fprintf(stderr, "ERROR: Corrupt compressed block\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+Status decode_secret_file_data(DecodeInfo *decInfo)     
+{
+    
+    unsigned long long len;
+    size_t left = decInfo->bmp.carrier_size - decInfo->iter.pos;
+    int max_chunk = decInfo->codec == CODEC_LZ ? LZ_BLOCK_SIZE :
+                    MAX_SECRET_BUF_SIZE - MAX_SECRET_BUF_SIZE % decInfo->lsb_depth;  // Same chunking as the encoder
+
+    // Every LZ block takes at least a block word and a byte, every stored byte at least two carrier bytes
+    if (decode_size(decInfo, &len) == e_failure ||
+        (decInfo->codec == CODEC_LZ
+             ? (len / LZ_BLOCK_SIZE + (len % LZ_BLOCK_SIZE != 0)) * (lsb_carrier_bytes(4, decInfo->lsb_depth) + 1) > left
+             : len > left || lsb_carrier_bytes(len, decInfo->lsb_depth) > left))
+    {
+        fprintf(stderr, "ERROR: Invalid secret file length\n");
+        return e_failure;
+    }
+    decInfo->size_secret_file = len;
+
+    if (open_decoded_file(decInfo) == e_failure)
+    {
+        return e_failure;
+    }
+
+    // Decode chunk by chunk and write each one straight to the output file
+    decInfo->crc = 0;
+    while (len > 0)
+    {
+        int chunk = len < (unsigned long long)max_chunk ? (int)len : max_chunk;
+
+        // A compressed secret has one block per chunk
+        if ((decInfo->codec == CODEC_LZ ? decode_lz_block(chunk, decInfo)
+                                        : decode_string(chunk, decInfo->secret_data, decInfo)) == e_failure ||
+            add_secrate_data_to_file(decInfo->secret_data, chunk, decInfo) == e_failure)
+        {
+            return e_failure;
+        }
+        decInfo->crc = crc32c_update(decInfo->crc, decInfo->secret_data, chunk);
+        len -= chunk;
+    }
+
+    // Images written before FORMAT_CRC cannot be checked
+    if (decInfo->has_crc && (uint)decode_len(decInfo) != decInfo->crc)
+    {
+        fprintf(stderr, "ERROR: Secret data checksum does not match, the image is damaged\n");
+        return e_failure;
+    }
+    return e_success;
+}
+
+Status decode_magic_string(DecodeInfo *decInfo)             
+{
+    // Start reading at the first carrier byte of the current layout
+    skip_header(decInfo->fptr_stego_image, decInfo->bmp.pixel_offset);
+    pixel_iter_init(&decInfo->iter, &decInfo->bmp, decInfo->fptr_stego_image, NULL);
+    if (decInfo->opts != NULL && decInfo->opts->pipeline)
+    {
+        pixel_iter_pipeline(&decInfo->iter);
+    }
+    decInfo->lsb_depth = 1;  // The magic string is always stored 1 bit per byte
+    decInfo->header_version = 0;
+
+    uint word = decode_len(decInfo);  // Decode the length of the magic string
+    int len = word & 0xFF;
+
+    if (len >= 10 || ((word >> 8) & 0xFF) > STEG_HEADER_VERSION || (word >> 16) != 0)
+    {
+        return e_failure;
+    }
+
+    char str[len + 1];  // +1 for  the null character
+
+    // Compare the decoded string with the expected magic string
+    if (decode_string(len, str, decInfo) == e_failure || strcmp(str, decInfo->magic_string) != 0)
+    {
+        return e_failure;
+    }
+    decInfo->header_version = (word >> 8) & 0xFF;
+
+    return e_success;
+}
+
+Status decode_header_format(DecodeInfo *decInfo)
+{
+    decInfo->codec = CODEC_NONE;
+    decInfo->has_crc = 0;
+    if (decInfo->header_version == 0)
+    {
+        return e_success;  // Written before the format word existed, 1 bit per byte
+    }
+
+    int format = decode_len(decInfo);
+    int depth = format & FORMAT_DEPTH_MASK;
+    int codec = (format & FORMAT_CODEC_MASK) >> FORMAT_CODEC_SHIFT;
+
+    if (depth < 1 || depth > MAX_LSB_DEPTH)
+    {
+        fprintf(stderr, "ERROR: Unsupported LSB depth %d\n", depth);
+        return e_failure;
+    }
+    if (codec != CODEC_NONE && codec != CODEC_LZ)
+    {
+        fprintf(stderr, "ERROR: Unsupported codec %d\n", codec);
+        return e_failure;
+    }
+    if (format & FORMAT_ARCHIVE)
+    {
+        fprintf(stderr, "ERROR: %s holds an archive, list it with -l or extract a file with -x <name>\n",
+                decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (format & FORMAT_SHARD)
+    {
+        fprintf(stderr, "ERROR: %s holds one shard of a split secret, decode every shard with -D\n",
+                decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if ((format & FORMAT_CHANNEL_MASK) != 0 &&
+        bmp_set_channels(&decInfo->bmp, decInfo->iter.pos, (format & FORMAT_CHANNEL_MASK) >> FORMAT_CHANNEL_SHIFT) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        return e_failure;
+    }
+    decInfo->lsb_depth = depth;
+    decInfo->codec = codec;
+    decInfo->has_crc = (format & FORMAT_CRC) != 0;
+    return e_success;
+}
+
+int decode_len(DecodeInfo *decInfo)         // Decode the string length    
+{
+    unsigned char buffer[32];  
+    unsigned char bytes[4];
+    size_t n = lsb_carrier_bytes(4, decInfo->lsb_depth);
+
+    if (pixel_iter_read(&decInfo->iter, buffer, n) == e_failure)
+    {
+        return -1;  // Callers reject negative lengths
+    }
+
+    // Extract the length from the low bits of each byte, LSB first
+    lsb_extract_depth(bytes, buffer, 4, decInfo->lsb_depth);
+
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);  // Return the decoded length
+}
+
+Status decode_size(DecodeInfo *decInfo, unsigned long long *size)
+{
+    unsigned char buffer[STEG_SIZE_BYTES * 8];
+    unsigned char bytes[STEG_SIZE_BYTES];
+    int nbytes = decInfo->header_version >= STEG_WIDE_VERSION ? STEG_SIZE_BYTES : 4;  // Older images have 32-bit sizes
+    size_t n = lsb_carrier_bytes(nbytes, decInfo->lsb_depth);
+
+    if (pixel_iter_read(&decInfo->iter, buffer, n) == e_failure)
+    {
+        return e_failure;
+    }
+    lsb_extract_depth(bytes, buffer, nbytes, decInfo->lsb_depth);
+    *size = 0;
+    for (int i = nbytes - 1; i >= 0; i--)
+    {
+        *size = *size << 8 | bytes[i];
+    }
+    return e_success;
+}
+
+Status decode_string(int len, char str[], DecodeInfo *decInfo)      // Decode the string          
+{
+    int i = 0;
+    int max_chunk = MAX_SECRET_BUF_SIZE - MAX_SECRET_BUF_SIZE % decInfo->lsb_depth;
+
+    // Decode in chunks so the stego buffer never exceeds MAX_IMAGE_BUF_SIZE
+    while (i < len)
+    {
+        int chunk = len - i < max_chunk ? len - i : max_chunk;
+        size_t n = lsb_carrier_bytes(chunk, decInfo->lsb_depth);
+
+        if (pixel_iter_read(&decInfo->iter, (unsigned char *)decInfo->image_data, n) == e_failure)
+        {
+            fprintf(stderr, "ERROR: Stego image ended while decoding\n");
+            return e_failure;
+        }
+
+        // Decode each character by extracting its bits
+        lsb_extract_depth((unsigned char *)str + i, (unsigned char *)decInfo->image_data, chunk, decInfo->lsb_depth);
+        i += chunk;
+    }
+    str[i] = '\0';  // Null-terminate the decoded string
+
+    return e_success;
+}
+
+Status open_decoded_file(DecodeInfo *decInfo)
+{
+    // Open the secret file for writing
+    decInfo->fptr_secret = stream_open(decInfo->secret_fname, "wb");
+    
+    if (decInfo->fptr_secret == NULL)
+    {
+        perror("fopen");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+    else
+    {
+        LOG_INFO("INFO : %s file open\n", decInfo->secret_fname);
+    }
+
+    // Chunks are already large, so skip the extra copy through the stdio buffer
+    setvbuf(decInfo->fptr_secret, NULL, _IONBF, 0);
+
+    return e_success;
+}
+
+Status add_secrate_data_to_file(const char str[], int len, DecodeInfo *decInfo)             
+{
+    // Write the decoded secret data to the file; fwrite keeps embedded NUL bytes
+    if (fwrite(str, 1, len, decInfo->fptr_secret) != (size_t)len)
+    {
+        perror("fwrite");
+        fprintf(stderr, "ERROR: Unable to write file %s\n", decInfo->secret_fname);
+        return e_failure;
+    }
+
+    return e_success;
+}
@@ -1,56 +1,81 @@
-/*
-Name : Sharan
-Date : 20/10/2024
-Description : Implementation of LSB image Steganography project
-*/
-
-#ifndef DECODE_H
-#define DECODE_H
-
-#include <stdio.h>
-#include "types.h" // Contains user-defined types
-
-/* 
- * Structure to store information required for
- * decoding secret file from a source Image
- * Info about output and intermediate data is
- * also stored
- */
-
-typedef struct _DecodeInfo
-{
-    char magic_string[20];
-
-    /* Secret File Info */
-    char secret_fname[30];        // Name of the secret file
-    FILE *fptr_secret;            // File pointer for the secret file
-
-    int size_ext_file;            // Size of the secret file extension
-    long size_secret_file;        // Size of the secret file
-
-    /* Stego Image Info */
-    char *stego_image_fname;     // Name of the stego image file
-    FILE *fptr_stego_image;      // File pointer for the stego image
-
-} DecodeInfo;
-
-/* Function prototypes */
-Status do_decoding(DecodeInfo *decInfo);           // Decode operation
-
-Status open_file(DecodeInfo *decInfo);              // Open file for decoding
-
-Status skip_header(FILE *fptr);                      // Skip BMP header
-
-Status decode_magic_string(DecodeInfo *decInfo);    // Decode the magic string
-
-int decode_len(DecodeInfo *decInfo);                // Decode the length of the data
-
-Status decode_string(int len,char string[],DecodeInfo *decInfo);      //decode the string
-
-Status decode_secret_file_extn(DecodeInfo *decInfo); // Decode the secret file extension
-
-Status decode_secret_file_data(DecodeInfo *decInfo); // Decode the secret file data
-
-Status add_secrate_data_to_file(char str[],DecodeInfo *decInfo);
-
-#endif
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "types.h" // Contains user-defined types
+#include "common.h"
+#include "bmp.h"
+#include "lz_codec.h"
+#include "crc32c.h"
+#include "stats.h"
+
+/* 
+ * Structure to store information required for
+ * decoding secret file from a source Image
+ * Info about output and intermediate data is
+ * also stored
+ */
+
+typedef struct _DecodeInfo
+{
+    char magic_string[20];
+
+    /* Secret File Info */
+    char secret_fname[30];        // Name of the secret file
+    FILE *fptr_secret;            // File pointer for the secret file
+
+    int header_version;           // Version found next to the magic string length
+    int lsb_depth;                // LSB bits per byte for the next field
+    int codec;                    // Secret data codec from the format word
+    int has_crc;                  // FORMAT_CRC was set, a CRC32C follows the data
+    uint crc;                     // CRC32C of the secret data decoded so far
+    int size_ext_file;            // Size of the secret file extension
+    off_t size_secret_file;       // Size of the secret file
+    char secret_data[MAX_SECRET_BUF_SIZE + 1];  // Decoded chunk (+1 for decode_string's NUL)
+    char lz_data[LZ_BLOCK_SIZE + 1];            // Compressed block before decompression
+
+    /* Stego Image Info */
+    char *stego_image_fname;     // Name of the stego image file
+    FILE *fptr_stego_image;      // File pointer for the stego image
+    BmpInfo bmp;                 // Layout of the stego image pixel array
+    PixelIter iter;              // Carrier bytes of the pixel array
+    char image_data[MAX_IMAGE_BUF_SIZE];  // Stego bytes for one chunk
+
+    const StegOptions *opts;     // Command line options
+    StegStats *stats;            // Per-phase counters for --stats, NULL when off
+
+} DecodeInfo;
+
+/* Function prototypes */
+Status do_decoding(DecodeInfo *decInfo);           // Decode operation
+
+Status open_file(DecodeInfo *decInfo);              // Open file for decoding
+
+Status skip_header(FILE *fptr, size_t offset);      // Skip BMP header up to the pixel array
+
+Status decode_magic_string(DecodeInfo *decInfo);    // Decode the magic string
+
+Status decode_header_format(DecodeInfo *decInfo);   // Decode the format word, switch LSB depth and codec
+
+int decode_len(DecodeInfo *decInfo);                // Decode the length of the data
+
+Status decode_size(DecodeInfo *decInfo, unsigned long long *size);  // Decode a size word, 32 bits before STEG_WIDE_VERSION
+
+Status decode_string(int len,char string[],DecodeInfo *decInfo);      //decode the string
+
+Status decode_secret_file_extn(DecodeInfo *decInfo); // Decode the secret file extension
+
+Status decode_secret_file_data(DecodeInfo *decInfo); // Decode the secret file data
+
+Status open_decoded_file(DecodeInfo *decInfo);      // Open the output file for the secret data
+
+Status add_secrate_data_to_file(const char str[], int len, DecodeInfo *decInfo);
+
+#endif
@@ -4,43 +4,56 @@ Date : 20/10/2024
 Description : Implementation of LSB image Steganography project
 */
 
+#ifdef __linux__
+#define _GNU_SOURCE  // copy_file_range
+#endif
+
 #include <stdio.h>
 #include "encode.h"
 #include "types.h"
 #include "common.h"
 #include <string.h>
+#include <time.h>
+#include "lsb_kernel.h"
+#include "stream.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#endif
+
+/* Block size for the userspace fallback of copy_remaining_img_data */
+#define COPY_BUF_SIZE (64 * 1024)
 
 /* Function Definitions */
 
 /* 
  * Get image size for BMP 
  * Input: Image file pointer
- * Output: Returns the size of the image (width * height * 3)
- * Description: Reads the width and height from the BMP header (at offset 18 and 22) 
- * and calculates the total image size in bytes.
+ * Output: Returns the number of carrier bytes in the pixel array
+ * Description: Parses the BMP headers and counts the pixel bytes of
+ * every row, leaving out the row padding.
  */
-uint get_image_size_for_bmp(FILE *fptr_image)
+size_t get_image_size_for_bmp(FILE *fptr_image)
 {
-    uint width, height;
-    // Seek to 18th byte in BMP to read width
-    fseek(fptr_image, 18, SEEK_SET);
-
-    // Read the width (an int)
-    fread(&width, sizeof(int), 1, fptr_image);
-    printf("width = %u\n", width);
+    BmpInfo bmp;
 
-    // Read the height (an int)
-    fread(&height, sizeof(int), 1, fptr_image);
-    printf("height = %u\n", height);
+    if (read_bmp_info(fptr_image, &bmp) == e_failure)
+    {
+        return 0;
+    }
+    LOG_INFO("width = %d\n", bmp.width);
+    LOG_INFO("height = %d\n", bmp.height);
 
-    // Return image size in bytes (width * height * 3 for 24-bit image)
-    return width * height * 3;
+    return bmp.carrier_size;
 }
 
 Status open_files(EncodeInfo *encInfo)
 {
     // Open source image in binary read mode
-    encInfo->fptr_src_image = fopen(encInfo->src_image_fname, "rb");
+    encInfo->fptr_src_image = stream_open_forward(encInfo->src_image_fname);  // A piped image is streamed
     if (encInfo->fptr_src_image == NULL)
     {
     	perror("fopen");
@@ -49,11 +62,11 @@ Status open_files(EncodeInfo *encInfo)
     }
     else
     {
-        printf("INFO : %s file open\n", encInfo->src_image_fname);
+        LOG_INFO("INFO : %s file open\n", encInfo->src_image_fname);
     }
 
     // Open secret file in read mode
-    encInfo->fptr_secret = fopen(encInfo->secret_fname, "r");
+    encInfo->fptr_secret = stream_open(encInfo->secret_fname, "rb");
     if (encInfo->fptr_secret == NULL)
     {
     	perror("fopen");
@@ -62,11 +75,11 @@ Status open_files(EncodeInfo *encInfo)
     }
     else
     {
-        printf("INFO : %s file open\n", encInfo->secret_fname);
+        LOG_INFO("INFO : %s file open\n", encInfo->secret_fname);
     }
 
     // Open stego image in binary write mode
-    encInfo->fptr_stego_image = fopen(encInfo->stego_image_fname, "wb");
+    encInfo->fptr_stego_image = stream_open(encInfo->stego_image_fname, "wb");
     if (encInfo->fptr_stego_image == NULL)
     {
     	perror("fopen");
@@ -75,206 +88,555 @@ Status open_files(EncodeInfo *encInfo)
     }
     else
     {
-        printf("INFO : %s file open\n", encInfo->stego_image_fname);
+        LOG_INFO("INFO : %s file open\n", encInfo->stego_image_fname);
     }
 
     return e_success;
 }
 
 
+/* End the open --stats phase and start the next one, counting I/O from the stream positions */
+static void encode_phase(EncodeInfo *encInfo, const char *name, long long secret_read)
+{
+    if (encInfo->stats != NULL)
+    {
+        // The streams stand still while the pipeline does the I/O
+        long long img_read = encInfo->iter.pl != NULL ? (long long)encInfo->iter.file_pos : ftello(encInfo->fptr_src_image);
+        long long img_written = encInfo->iter.pl != NULL ? (long long)encInfo->iter.file_pos : ftello(encInfo->fptr_stego_image);
+        stats_phase(encInfo->stats, name, img_read + secret_read, img_written, encInfo->iter.pos);
+    }
+}
+
 Status do_encoding(EncodeInfo *encInfo)                 
 {
-    printf("INFO: Rewinding the source image file for encoding.\n");    
+    LOG_INFO("INFO: Rewinding the source image file for encoding.\n");    
     rewind(encInfo->fptr_src_image);                                    // Rewind the source image file to the beginning
+    pixel_iter_init(&encInfo->iter, &encInfo->bmp, encInfo->fptr_src_image, encInfo->fptr_stego_image);
 
-    printf("INFO: Starting to copy the BMP header.\n");
-    copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image);    // Copy the BMP header (first 54 bytes) to the stego image
-    printf("INFO: BMP header copied successfully.\n");
+    LOG_INFO("INFO: Starting to copy the BMP header.\n");
+    encode_phase(encInfo, "header", 0);
+    if (copy_bmp_header(encInfo->fptr_src_image, encInfo->fptr_stego_image, encInfo->bmp.pixel_offset) == e_failure)  // Copy everything up to the pixel array
+    {
+        return e_failure;
+    }
+    LOG_INFO("INFO: BMP header copied successfully.\n");
+    if (encInfo->opts != NULL && encInfo->opts->pipeline)
+    {
+        pixel_iter_pipeline(&encInfo->iter);
+    }
 
-    printf("INFO: Encoding the Magic String signature.\n");
-    encode_magic_string(encInfo->magic_string, encInfo);                // Encode the magic string 
-    printf("INFO: Magic String encoded successfully.\n");
+    LOG_INFO("INFO: Encoding the Magic String signature.\n");
+    encode_phase(encInfo, "magic", 0);
+    if (encode_magic_string(encInfo->magic_string, encInfo) == e_failure)  // Encode the magic string
+    {
+        pixel_iter_close(&encInfo->iter);
+        return e_failure;
+    }
+    LOG_INFO("INFO: Magic String encoded successfully.\n");
 
-    printf("INFO: Encoding the secret file extension size.\n");
-    encode_secret_file_extn(encInfo);                                   // Encode the secret file extension into stego image
-    printf("INFO: Secret file extension encoded successfully.\n");
+    LOG_INFO("INFO: Encoding the header format.\n");
+    if (encode_header_format(encInfo) == e_failure)                     // Record the LSB depth used from here on
+    {
+        pixel_iter_close(&encInfo->iter);
+        return e_failure;
+    }
+    LOG_INFO("INFO: Header format encoded successfully (%d bit LSB depth).\n", encInfo->lsb_depth);
 
-    printf("INFO: Encoding the secret file data.\n");
-    encode_secret_file_data(encInfo);                                   // Encode the secret file data
-    printf("INFO: Secret file data encoded successfully.\n");
+    LOG_INFO("INFO: Encoding the secret file extension size.\n");
+    encode_phase(encInfo, "extn", 0);
+    if (encode_secret_file_extn(encInfo) == e_failure)                  // Encode the secret file extension into stego image
+    {
+        pixel_iter_close(&encInfo->iter);
+        return e_failure;
+    }
+    LOG_INFO("INFO: Secret file extension encoded successfully.\n");
+
+    LOG_INFO("INFO: Encoding the secret file data.\n");
+    encode_phase(encInfo, "data", 0);
+    if (encode_secret_file_data(encInfo) == e_failure)                  // Encode the secret file data
+    {
+        pixel_iter_close(&encInfo->iter);
+        return e_failure;
+    }
+    LOG_INFO("INFO: Secret file data encoded successfully.\n");
+    if (pixel_iter_close(&encInfo->iter) == e_failure)
+    {
+        return e_failure;
+    }
 
     
-    printf("INFO: Copying the remaining image data after encoding.\n");
+    LOG_INFO("INFO: Copying the remaining image data after encoding.\n");
+    encode_phase(encInfo, "copy_tail", encInfo->size_secret_file);    // The data phase read the whole secret
     copy_remaining_img_data(encInfo->fptr_src_image, encInfo->fptr_stego_image);        // Copy any remaining data from the source image to the stego image
-    printf("INFO: Remaining image data copied successfully.\n");
+    encode_phase(encInfo, NULL, encInfo->size_secret_file);
+    LOG_INFO("INFO: Remaining image data copied successfully.\n");
 
     return e_success;
 }
 
-uint get_file_size(FILE *fptr)  // get the size of the file
+off_t get_file_size(FILE *fptr)  // get the size of the file
 {
-    fseek(fptr, 0, SEEK_END);  
-    return ftell(fptr);  
+    fseeko(fptr, 0, SEEK_END);  
+    return ftello(fptr);  
 }
 
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image)     // Copy 54 bytes of BMP header 
+Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image, size_t size)     // Copy the BMP headers and palette/masks
 {
-    unsigned char ch[54];  
-    rewind(fptr_src_image);  
-    fread(ch, 54, 1, fptr_src_image);  
-    fwrite(ch, 54, 1, fptr_dest_image);  
+    unsigned char ch[1024];
+    rewind(fptr_src_image);
+
+    while (size > 0)
+    {
+        size_t n = size < sizeof(ch) ? size : sizeof(ch);
+        if (fread(ch, n, 1, fptr_src_image) != 1 || fwrite(ch, n, 1, fptr_dest_image) != 1)
+        {
+            fprintf(stderr, "ERROR: Unable to copy the BMP header\n");
+            return e_failure;
+        }
+        size -= n;
+    }
 
     return e_success;
 }
 
+/* Largest chunk that is a whole number of depth-byte groups, so chunks join seamlessly */
+static int max_chunk_size(int depth)
+{
+    return MAX_SECRET_BUF_SIZE - MAX_SECRET_BUF_SIZE % depth;
+}
+
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo)
 {
     int len = strlen(magic_string);
-    encode_length(len, encInfo);  // Encode length 
-    encode_string(len, magic_string, encInfo);  // Encode the string
+    encInfo->lsb_depth = 1;  // The magic string is always stored 1 bit per byte
+    if (encode_length(len | (STEG_HEADER_VERSION << 8), encInfo) == e_failure)  // Encode length and header version
+    {
+        return e_failure;
+    }
+    return encode_string(len, magic_string, encInfo);  // Encode the string
+}
+
+Status encode_header_format(EncodeInfo *encInfo)
+{
+    int depth = encInfo->opts != NULL && encInfo->opts->lsb_depth > 0 ? encInfo->opts->lsb_depth : 1;
+    int codec = encInfo->opts != NULL && encInfo->opts->compress ? CODEC_LZ : CODEC_NONE;
+
+    if (encode_length((depth & FORMAT_DEPTH_MASK) | (codec << FORMAT_CODEC_SHIFT) | FORMAT_CRC |
+                      (encInfo->channel_mask << FORMAT_CHANNEL_SHIFT), encInfo) == e_failure)  // Format word, still 1 bit per byte
+    {
+        return e_failure;
+    }
+    // The pixel iterator carries on in the narrowed carrier
+    if (encInfo->channel_mask != 0 && bmp_set_channels(&encInfo->bmp, encInfo->iter.pos, encInfo->channel_mask) == e_failure)
+    {
+        fprintf(stderr, "ERROR: --channels: %s\n", steg_last_error());
+        return e_failure;
+    }
+    encInfo->lsb_depth = depth;
+    encInfo->codec = codec;
     return e_success;
 }
 
 Status encode_length(int len, EncodeInfo *encInfo)
 {
-    char buffer[32];
-    fread(buffer, 32, 1, encInfo->fptr_src_image);  // Read 32 bytes from source image
-
-    // Modify the LSB of each byte to store the length
-    for (int i = 0; i < 32; i++)
+    unsigned char buffer[32];
+    unsigned char bytes[4] = { len, len >> 8, len >> 16, len >> 24 };  // Little endian, bit i -> bit i of the stream
+    size_t n = lsb_carrier_bytes(4, encInfo->lsb_depth);
+    if (pixel_iter_read(&encInfo->iter, buffer, n) == e_failure)  // Read the carrier bytes from source image
     {
-        buffer[i] = (~1) & buffer[i];  // Clear LSB
-        if ((1 << i) & len)
-        {
-            buffer[i] = buffer[i] | 1;  // Set LSB if needed
-        }
+        return e_failure;
     }
 
-    fwrite(buffer, 32, 1, encInfo->fptr_stego_image);  // Write modified bytes to stego image
-    return e_success;
+    lsb_embed_depth(buffer, buffer, bytes, 4, encInfo->lsb_depth);  // Store the length in the low bits of each byte
+
+    return pixel_iter_write(&encInfo->iter, buffer, n);  // Write modified bytes to stego image
+}
+
+Status encode_size(unsigned long long size, EncodeInfo *encInfo)
+{
+    unsigned char buffer[STEG_SIZE_BYTES * 8];
+    unsigned char bytes[STEG_SIZE_BYTES];
+    size_t n = lsb_carrier_bytes(STEG_SIZE_BYTES, encInfo->lsb_depth);
+
+    for (int i = 0; i < STEG_SIZE_BYTES; i++)
+    {
+        bytes[i] = size >> (8 * i);  // Little endian like encode_length
+    }
+    if (pixel_iter_read(&encInfo->iter, buffer, n) == e_failure)
+    {
+        return e_failure;
+    }
+    lsb_embed_depth(buffer, buffer, bytes, STEG_SIZE_BYTES, encInfo->lsb_depth);
+    return pixel_iter_write(&encInfo->iter, buffer, n);
 }
 
 Status encode_string(int len, const char *str, EncodeInfo *encInfo)
 {
-    char buffer[8 * len];
-    fread(buffer, 8 * len, 1, encInfo->fptr_src_image);  // Read 8 * length bytes from source
+    int max_chunk = max_chunk_size(encInfo->lsb_depth);
 
-    int k = 0;
-    for (int i = 0; i < len; i++)
+    // Encode in chunks so the carrier buffer never exceeds MAX_IMAGE_BUF_SIZE
+    while (len > 0)
     {
-        for (int j = 0; j < 8; j++)
+        int chunk = len < max_chunk ? len : max_chunk;
+        size_t n = lsb_carrier_bytes(chunk, encInfo->lsb_depth);
+
+        if (pixel_iter_read(&encInfo->iter, (unsigned char *)encInfo->image_data, n) == e_failure)  // Read the carrier bytes for this chunk
         {
-            buffer[k] = buffer[k] & (~1);  // Clear LSB
-            if ((1 << j) & str[i])
-            {
-                buffer[k] = buffer[k] | 1;  // Set LSB if needed
-            }
-            k++;
+            fprintf(stderr, "ERROR: Source image ended while encoding\n");
+            return e_failure;
         }
-    }
 
-    fwrite(buffer, 8 * len, 1, encInfo->fptr_stego_image);  // Write to stego image
+        lsb_embed_depth((unsigned char *)encInfo->image_data, (unsigned char *)encInfo->image_data,
+                        (const unsigned char *)str, chunk, encInfo->lsb_depth);
+
+        if (pixel_iter_write(&encInfo->iter, (unsigned char *)encInfo->image_data, n) == e_failure)  // Write to stego image
+        {
+            return e_failure;
+        }
+        str += chunk;
+        len -= chunk;
+    }
     return e_success;
 }
 
+const char *secret_file_extn(const char *fname)
+{
+    const char *base = strrchr(fname, '/');
+    const char *dot = strchr(base != NULL ? base + 1 : fname, '.');  // First dot of the file name, not of a directory
+
+    return dot != NULL ? dot : fname + strlen(fname);
+}
+
+size_t secret_file_stem_len(const char *fname)
+{
+    return secret_file_extn(fname) - fname;
+}
+
 int secret_file_extn_len(EncodeInfo *encInfo)
 {
-    int i, size;
-    for (i = 0; encInfo->secret_fname[i] != '.'; i++);  // Find the position of the dot
-    for (size = 0; encInfo->secret_fname[i + size] != '\0'; size++);  // Calculate the extension length
-    return size;
+    return strlen(secret_file_extn(encInfo->secret_fname));  // Calculate the extension length
 }
 
 Status encode_secret_file_extn(EncodeInfo *encInfo)
 {
     int len = secret_file_extn_len(encInfo);  // Get the length of the extension
-    encode_length(len, encInfo);  // Encode length 
-    int i;
-    for ( i = 0; encInfo->secret_fname[i] != '.'; i++);  // Find the starting point of the extension
-    encode_string(len, encInfo->secret_fname + i, encInfo);  // Encode the extension
-    return e_success;
+    if (encode_length(len, encInfo) == e_failure)  // Encode length
+    {
+        return e_failure;
+    }
+    return encode_string(len, secret_file_extn(encInfo->secret_fname), encInfo);  // Encode the extension
 }
 
 
+/* Compress one block of secret_data and encode it behind its block word; returns the stored size or -1 */
+static int encode_lz_block(int len, EncodeInfo *encInfo)
+{
+    // Keep the block as is unless compressing saves at least a byte
+    int size = lz_compress_block((const unsigned char *)encInfo->secret_data, len,
+                                 (unsigned char *)encInfo->lz_data, len - 1);
+
+    if (size < 0)
+    {
+        if (encode_length(len | LZ_BLOCK_RAW, encInfo) == e_failure ||
+            encode_string(len, encInfo->secret_data, encInfo) == e_failure)
+        {
+            return -1;
+        }
+        return len;
+    }
+    if (encode_length(size, encInfo) == e_failure || encode_string(size, encInfo->lz_data, encInfo) == e_failure)
+    {
+        return -1;
+    }
+    return size;
+}
+
 Status encode_secret_file_data(EncodeInfo *encInfo)
 {
-    int len = get_file_size(encInfo->fptr_secret);  // Get the size of the secret file
-    encode_length(len, encInfo);  // Encode the length of the file
+    off_t len = get_file_size(encInfo->fptr_secret);  // Get the size of the secret file
+    int max_chunk = encInfo->codec == CODEC_LZ ? LZ_BLOCK_SIZE : max_chunk_size(encInfo->lsb_depth);
+    long long stored = 0;
+    encode_size(len, encInfo);  // Encode the length of the file, uncompressed
+    encInfo->crc = 0;
 
-    char str[len];
     rewind(encInfo->fptr_secret);  // Rewind to start of secret file
 
-    for (int i = 0; i < len; i++)
+    // Stream the secret through secret_data so memory use does not depend on its size
+    while (len > 0)
+    {
+        int chunk = len < max_chunk ? len : max_chunk;
+
+        if (fread(encInfo->secret_data, 1, chunk, encInfo->fptr_secret) != (size_t)chunk)
+        {
+            fprintf(stderr, "ERROR: Unable to read %s\n", encInfo->secret_fname);
+            return e_failure;
+        }
+        encInfo->crc = crc32c_update(encInfo->crc, encInfo->secret_data, chunk);  // Checksum the chunk while it is in cache
+
+        if (encInfo->codec == CODEC_LZ)
+        {
+            int size = encode_lz_block(chunk, encInfo);  // Each chunk is one compressed block
+            if (size < 0)
+            {
+                return e_failure;
+            }
+            stored += size;
+        }
+        else if (encode_string(chunk, encInfo->secret_data, encInfo) == e_failure)  // Encode this chunk of secret file data
+        {
+            return e_failure;
+        }
+        len -= chunk;
+    }
+
+    if (encInfo->codec == CODEC_LZ)
     {
-        char ch = getc(encInfo->fptr_secret);  // Read each character from secret file
-        str[i] = ch;
+        if (encInfo->stats != NULL)
+        {
+            encInfo->stats->compressed = stored;
+        }
+        LOG_INFO("INFO: Compressed %lld bytes of secret data to %lld bytes\n", (long long)encInfo->size_secret_file, stored);
     }
+    return encode_length(encInfo->crc, encInfo);  // FORMAT_CRC trailer
+}
 
-    encode_string(len, str, encInfo);  // Encode the secret file data
-    return e_success;
+/* Wall clock in seconds, used for the throughput report */
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest)
+#ifdef __linux__
+/*
+ * Copy the tail inside the kernel with copy_file_range, or sendfile
+ * when the filesystems do not support it. Returns the number of bytes
+ * copied; anything left over is copied by the caller in userspace.
+ */
+static long long kernel_copy_tail(FILE *fptr_src, FILE *fptr_dest)
 {
-    char buffer;
-    int temp;
+    struct stat st;
+    int fd_src = fileno(fptr_src);
+    int fd_dest = fileno(fptr_dest);
+    off_t src_off = ftello(fptr_src);
+    off_t dest_off;
+    long long copied = 0;
+    int use_sendfile = 0;
+
+    if (src_off < 0 || fflush(fptr_dest) != 0 || fstat(fd_src, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return 0;
+    }
+    dest_off = ftello(fptr_dest);
+    if (dest_off < 0)
+    {
+        return 0;
+    }
 
-    temp = fread(&buffer, 1, 1, fptr_src);
+    while (src_off < st.st_size)
+    {
+        size_t remaining = st.st_size - src_off;
+        ssize_t n;
+
+        if (!use_sendfile)
+        {
+            n = copy_file_range(fd_src, &src_off, fd_dest, &dest_off, remaining, 0);
+            if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL))
+            {
+                use_sendfile = 1;  // Not supported between these files, try sendfile
+                continue;
+            }
+        }
+        else
+        {
+            // sendfile writes at the current offset of the destination
+            if (lseek(fd_dest, dest_off, SEEK_SET) < 0)
+            {
+                break;
+            }
+            n = sendfile(fd_dest, fd_src, &src_off, remaining);
+            if (n > 0)
+            {
+                dest_off += n;
+            }
+        }
+
+        if (n <= 0)
+        {
+            break;
+        }
+        copied += n;
+    }
+
+    // Resync both streams with the file offsets moved by the kernel
+    fseeko(fptr_src, src_off, SEEK_SET);
+    fseeko(fptr_dest, dest_off, SEEK_SET);
+    return copied;
+}
+#endif
+
+Status copy_remaining_img_data(FILE *fptr_src, FILE *fptr_dest)
+{
+    char buffer[COPY_BUF_SIZE];
+    size_t temp;
+    long long copied = 0;
+    double start = get_time_sec();
+    double elapsed;
+
+#ifdef __linux__
+    copied = kernel_copy_tail(fptr_src, fptr_dest);
+#endif
+
+    // Copy whatever the kernel did not in large blocks
+    temp = fread(buffer, 1, COPY_BUF_SIZE, fptr_src);
     while (temp != 0)
     {
-        fwrite(&buffer, 1, 1, fptr_dest);  // Write the byte to the output file
-        temp = fread(&buffer, 1, 1, fptr_src);  // Read the next byte
+        if (fwrite(buffer, 1, temp, fptr_dest) != temp)  // Write the block to the output file
+        {
+            perror("fwrite");
+            return e_failure;
+        }
+        copied += temp;
+        temp = fread(buffer, 1, COPY_BUF_SIZE, fptr_src);  // Read the next block
     }
+
+    elapsed = get_time_sec() - start;
+    LOG_INFO("INFO: Copied %lld bytes in %.3f s (%.2f MB/s)\n", copied, elapsed,
+           elapsed > 0 ? copied / elapsed / (1024 * 1024) : 0.0);
     return e_success;
 }
 
-Status check_capacity(char *argv[], EncodeInfo *encInfo)
+/* Carrier bytes taken by the LZ blocks of the secret, found by compressing it once */
+static long long lz_carrier_bytes(EncodeInfo *encInfo, off_t len, int depth)
+{
+    long long needed = 0;
+
+    rewind(encInfo->fptr_secret);
+    while (len > 0)
+    {
+        int chunk = len < LZ_BLOCK_SIZE ? len : LZ_BLOCK_SIZE;
+        int size;
+
+        if (fread(encInfo->secret_data, 1, chunk, encInfo->fptr_secret) != (size_t)chunk)
+        {
+            return -1;
+        }
+        size = lz_compress_block((const unsigned char *)encInfo->secret_data, chunk,
+                                 (unsigned char *)encInfo->lz_data, chunk - 1);
+        needed += lsb_carrier_bytes(4, depth) + lsb_carrier_bytes(size < 0 ? chunk : size, depth);
+        len -= chunk;
+    }
+    return needed;
+}
+
+Status check_capacity(EncodeInfo *encInfo)
 {
-    int magic_string_length; 
-    int file_ext_length;
-    int secret_file_len; 
-    int src_file_length;
+    size_t magic_string_length; 
+    size_t file_ext_length;
+    off_t secret_file_len; 
+    unsigned long long needed;
+    int depth = encInfo->opts != NULL && encInfo->opts->lsb_depth > 0 ? encInfo->opts->lsb_depth : 1;
 
-    fseek(encInfo->fptr_src_image, 0, SEEK_END);  // Move to the end of the source image
-    src_file_length = ftell(encInfo->fptr_src_image);  // Get the size of the source file
+    if (read_bmp_info(encInfo->fptr_src_image, &encInfo->bmp) == e_failure)  // Parse the headers to find the pixel rows
+    {
+        return e_failure;
+    }
+    encInfo->image_capacity = encInfo->bmp.carrier_size;  // Row padding cannot hold data
+    encInfo->bits_per_pixel = encInfo->bmp.bits_per_pixel;
 
-    magic_string_length = strlen(MAGIC_STRING);  // Get the length of the magic string
+    magic_string_length = sizeof(encInfo->magic_string) - 1;  // Longest magic string, it is read after this check
+
+    encInfo->channel_mask = encInfo->opts != NULL ? encInfo->opts->channel_mask : 0;
+    if (bmp_check_channels(&encInfo->bmp, &encInfo->channel_mask) == e_failure)
+    {
+        fprintf(stderr, "ERROR: --channels: %s\n", steg_last_error());
+        return e_failure;
+    }
+    if (encInfo->channel_mask != 0)
+    {
+        // Only the chosen channels after the header hold data
+        BmpInfo narrowed = encInfo->bmp;
+        if (bmp_set_channels(&narrowed, 32 + magic_string_length * 8 + 32, encInfo->channel_mask) == e_failure)
+        {
+            fprintf(stderr, "ERROR: --channels: %s\n", steg_last_error());
+            return e_failure;
+        }
+        encInfo->image_capacity = narrowed.carrier_size;
+    }
 
     file_ext_length = secret_file_extn_len(encInfo);  // Get the length of the secret file extension
 
-    fseek(encInfo->fptr_secret, 0, SEEK_END);  // Move to the end of the secret file
-    secret_file_len = ftell(encInfo->fptr_secret);  // Get the size of the secret file
+    secret_file_len = get_file_size(encInfo->fptr_secret);  // Get the size of the secret file
+    if (secret_file_len < 0)
+    {
+        perror("ftello");
+        return e_failure;
+    }
 
+    encInfo->size_secret_file = secret_file_len;
+
+    // Magic string and format word at 1 bit per byte, the rest at the chosen depth
+    needed = 32 + magic_string_length * 8 + 32 +
+             2 * lsb_carrier_bytes(4, depth) +  // Extension length and CRC
+             lsb_carrier_bytes(STEG_SIZE_BYTES, depth) +  // Data length
+             lsb_carrier_bytes(file_ext_length, depth);
+
+    if (encInfo->opts != NULL && encInfo->opts->compress)
+    {
+        long long blocks = (secret_file_len + LZ_BLOCK_SIZE - 1) / LZ_BLOCK_SIZE;
+        long long lz_needed = blocks * (lsb_carrier_bytes(4, depth) + 1) + lsb_carrier_bytes(secret_file_len, depth);
+
+        // Only compress twice when the blocks might not fit stored as is
+        if (needed + lz_needed > encInfo->image_capacity)
+        {
+            lz_needed = lz_carrier_bytes(encInfo, secret_file_len, depth);
+            if (lz_needed < 0)
+            {
+                fprintf(stderr, "ERROR: Unable to read %s\n", encInfo->secret_fname);
+                return e_failure;
+            }
+        }
+        needed += lz_needed;
+    }
+    else
+    {
+        needed += lsb_carrier_bytes(secret_file_len, depth);
+    }
     
-    if ((src_file_length - 54) < (magic_string_length + file_ext_length + secret_file_len) * 8)  // Check if the source image has enough capacity to hold the encoded data
+    if (encInfo->image_capacity < needed)  // Check if the source image has enough capacity to hold the encoded data
     {
+        printf("Error! Source file size is below the required limit.\n");
         return e_failure;  // Fail if the image doesn't have enough space
     }
     return e_success;
 }
 
+int is_bmp_fname(const char *fname)
+{
+    size_t len = strlen(fname);
+
+    return stream_is_std(fname) || (len > 4 && strcmp(fname + len - 4, ".bmp") == 0);  // "-" streams a BMP
+}
+
 Status valid_argv_encode(int argc, char *argv[])
 {
-    if (strcmp(strchr(argv[2], '.'), ".bmp") != 0)      // Validate source image is a .bmp file
+    if (!is_bmp_fname(argv[2]))      // Validate source image is a .bmp file
     {
         printf("Error :  Pass <.BMP file>\n");
         return e_failure;
     }
     
-    if (argv[4] != NULL)                // Validate output image is a .bmp file
+    if (argc > 4 && !is_bmp_fname(argv[4]))                // Validate output image is a .bmp file
     {
-        if (strchr(argv[4], '.') != 0)
-        {
-            if (strcmp(strchr(argv[4], '.'), ".bmp") != 0)
-            {
-                printf("Error : Pass <.BMP file>\n");
-                return e_failure;
-            }
-        }
-        else
-        {
-            printf("Error : Pass <.BMP file>\n");
-            return e_failure;
-        }
+        printf("Error : Pass <.BMP file>\n");
+        return e_failure;
+    }
+
+    if (stream_is_std(argv[2]) && stream_is_std(argv[3]))
+    {
+        printf("Error : Only one of the image and secret file can be read from stdin\n");
+        return e_failure;
     }
+    return e_success;
 }
@@ -7,7 +7,14 @@ Description : Implementation of LSB image Steganography project
 #ifndef ENCODE_H
 #define ENCODE_H
 
+#include <stdio.h>
+#include <sys/types.h>
 #include "types.h" // Contains user defined types
+#include "common.h"
+#include "bmp.h"
+#include "lz_codec.h"
+#include "crc32c.h"
+#include "stats.h"
 
 /* 
  * Structure to store information required for
@@ -16,8 +23,6 @@ Description : Implementation of LSB image Steganography project
  * also stored
  */
 
-#define MAX_SECRET_BUF_SIZE 1
-#define MAX_IMAGE_BUF_SIZE (MAX_SECRET_BUF_SIZE * 8)
 #define MAX_FILE_SUFFIX 4
 
 typedef struct _EncodeInfo
@@ -26,8 +31,12 @@ typedef struct _EncodeInfo
     char *src_image_fname;
     FILE *fptr_src_image;
 
-    uint image_capacity;
+    size_t image_capacity;                  // Carrier bytes that can hold data
     uint bits_per_pixel;
+    BmpInfo bmp;                            // Parsed by check_capacity
+    PixelIter iter;                         // Carrier bytes of the pixel array
+    int lsb_depth;                          // LSB bits per byte for the next field
+    uint channel_mask;                      // Carrier channels after the format word, set by check_capacity
     char image_data[MAX_IMAGE_BUF_SIZE];    
     char magic_string[10];
 
@@ -37,25 +46,47 @@ typedef struct _EncodeInfo
 
     char extn_secret_file[MAX_FILE_SUFFIX];
     char secret_data[MAX_SECRET_BUF_SIZE];
-    long size_secret_file;
+    char lz_data[LZ_BLOCK_SIZE];            // Compressed block of secret_data
+    int codec;                              // CODEC_NONE or CODEC_LZ, set by encode_header_format
+    uint crc;                               // CRC32C of the secret data encoded so far
+    off_t size_secret_file;
 
     /* Stego Image Info */
     char *stego_image_fname;
     FILE *fptr_stego_image;
 
+    /* Command line options */
+    const StegOptions *opts;
+    StegStats *stats;                       // Per-phase counters for --stats, NULL when off
+
 } EncodeInfo;
 
 
 //validate validate argv in encode
 Status valid_argv_encode(int argc,char* argv[]);
 
+/* Whether fname names a .bmp file, or "-" for stdin/stdout */
+int is_bmp_fname(const char *fname);
+
+/* Extension of a secret file name from the first dot of its last component, "" when it has none */
+const char *secret_file_extn(const char *fname);
+
+/* Length of fname without that extension, the part a decoded extension replaces */
+size_t secret_file_stem_len(const char *fname);
+
 /* Encoding function prototype */
 
 /* Check operation type */
 OperationType check_operation_type(char *argv[]);
 
-/* Read and validate Encode args from argv */
-Status check_capacity(char *argv[], EncodeInfo *encInfo);
+/* Remove option flags from argv into opts, returns the new argc or -1 */
+int parse_options(int argc, char *argv[], StegOptions *opts);
+
+/* Magic string from --magic, --magic-fd or LSB_STEG_MAGIC, else prompted for on stdin unless stdin_busy */
+Status read_magic_string(const StegOptions *opts, char *magic, size_t size, int stdin_busy);
+
+/* Parse the carrier and check it can hold the magic string and the secret; prints the reason on failure */
+Status check_capacity(EncodeInfo *encInfo);
 
 /* Perform the encoding */
 Status do_encoding(EncodeInfo *encInfo);
@@ -63,21 +94,21 @@ Status do_encoding(EncodeInfo *encInfo);
 /* Get File pointers for i/p and o/p files */
 Status open_files(EncodeInfo *encInfo);
 
-/* check capacity */
-//Status check_capacity(EncodeInfo *encInfo);
-
 /* Get image size */
-uint get_image_size_for_bmp(FILE *fptr_image);
+size_t get_image_size_for_bmp(FILE *fptr_image);
 
 /* Get file size */
-uint get_file_size(FILE *fptr);
+off_t get_file_size(FILE *fptr);
 
-/* Copy bmp image header */
-Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image);
+/* Copy bmp image header, everything before the pixel array */
+Status copy_bmp_header(FILE *fptr_src_image, FILE *fptr_dest_image, size_t size);
 
 /* Store Magic String */
 Status encode_magic_string(const char *magic_string, EncodeInfo *encInfo);
 
+/* Encode the format word and switch to the chosen LSB depth and codec */
+Status encode_header_format(EncodeInfo *encInfo);
+
 /* Encode secret file extenstion */
 Status encode_secret_file_extn(EncodeInfo *encInfo);
 
@@ -86,6 +117,9 @@ int secret_file_extn_len(EncodeInfo *encInfo);
 /*Encode len and string*/
 Status encode_length(int len,EncodeInfo *encInfo);
 
+/* Encode a size word, 64 bits wide in the current header version */
+Status encode_size(unsigned long long size, EncodeInfo *encInfo);
+
 Status encode_string(int len,const char *str,EncodeInfo *encInfo);
 
 /* Encode secret file data*/
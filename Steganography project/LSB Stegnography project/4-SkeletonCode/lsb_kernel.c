@@ -0,0 +1,402 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include "lsb_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LSB_KERNEL_X86
+#include <immintrin.h>
+#define LSB_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+/* LSB of every byte in a 64-bit word */
+#define LSB_MASK_64 0x0101010101010101ULL
+
+typedef struct _LsbKernel
+{
+    const char *name;
+    lsb_embed_fn embed;
+    lsb_extract_fn extract;
+    lsb_embed_depth_fn embed_depth;
+    lsb_extract_depth_fn extract_depth;
+    int (*supported)(void);
+} LsbKernel;
+
+/* Portable reference kernel; every other kernel must match it byte for byte */
+static void embed_scalar(unsigned char *dst, const unsigned char *carrier,
+                         const unsigned char *payload, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char data = payload[i];
+        for (int j = 0; j < 8; j++)
+        {
+            dst[8 * i + j] = (carrier[8 * i + j] & 0xFE) | ((data >> j) & 1);  // Replace LSB with bit j
+        }
+    }
+}
+
+static void extract_scalar(unsigned char *payload, const unsigned char *carrier, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned char data = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            data |= (carrier[8 * i + j] & 1) << j;  // LSB of byte j is bit j
+        }
+        payload[i] = data;
+    }
+}
+
+/* Generic depth kernels: stream payload bits through an accumulator */
+static void embed_depth_scalar(unsigned char *dst, const unsigned char *carrier,
+                               const unsigned char *payload, size_t len, int depth)
+{
+    unsigned int mask = (1u << depth) - 1;
+    unsigned int acc = 0;
+    int nbits = 0;
+    size_t i = 0, n = lsb_carrier_bytes(len, depth);
+
+    for (size_t c = 0; c < n; c++)
+    {
+        if (nbits < depth)
+        {
+            if (i < len)
+            {
+                acc |= (unsigned int)payload[i++] << nbits;  // Refill with the next payload byte
+            }
+            nbits += 8;  // Past the end this pads with zero bits
+        }
+        dst[c] = (carrier[c] & ~mask) | (acc & mask);
+        acc >>= depth;
+        nbits -= depth;
+    }
+}
+
+static void extract_depth_scalar(unsigned char *payload, const unsigned char *carrier,
+                                 size_t len, int depth)
+{
+    unsigned int mask = (1u << depth) - 1;
+    unsigned int acc = 0;
+    int nbits = 0;
+
+    for (size_t i = 0, c = 0; i < len; c++)
+    {
+        acc |= (carrier[c] & mask) << nbits;
+        nbits += depth;
+        if (nbits >= 8)
+        {
+            payload[i++] = acc;
+            acc >>= 8;
+            nbits -= 8;
+        }
+    }
+}
+
+static int always_supported(void)
+{
+    return 1;
+}
+
+#ifdef LSB_KERNEL_X86
+
+/* 16 payload bytes -> 128 carrier bytes per iteration */
+LSB_TARGET("sse2")
+static void embed_sse2(unsigned char *dst, const unsigned char *carrier,
+                       const unsigned char *payload, size_t len)
+{
+    const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i keep = _mm_set1_epi8((char)0xFE);
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i *)(payload + i));
+        __m128i lo = _mm_unpacklo_epi8(p, p);
+        __m128i hi = _mm_unpackhi_epi8(p, p);
+        __m128i w[4] = { _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+                         _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi) };
+        __m128i q[8];
+
+        // Each q[k] holds payload bytes 2k and 2k + 1 repeated 8 times
+        for (int k = 0; k < 4; k++)
+        {
+            q[2 * k] = _mm_unpacklo_epi32(w[k], w[k]);
+            q[2 * k + 1] = _mm_unpackhi_epi32(w[k], w[k]);
+        }
+
+        for (int k = 0; k < 8; k++)
+        {
+            __m128i set = _mm_cmpeq_epi8(_mm_and_si128(q[k], bits), bits);
+            __m128i c = _mm_loadu_si128((const __m128i *)(carrier + 8 * i + 16 * k));
+            c = _mm_or_si128(_mm_and_si128(c, keep), _mm_and_si128(set, one));
+            _mm_storeu_si128((__m128i *)(dst + 8 * i + 16 * k), c);
+        }
+    }
+    embed_scalar(dst + 8 * i, carrier + 8 * i, payload + i, len - i);
+}
+
+/* 32 payload bytes -> 256 carrier bytes per iteration */
+LSB_TARGET("avx2")
+static void embed_avx2(unsigned char *dst, const unsigned char *carrier,
+                       const unsigned char *payload, size_t len)
+{
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                          1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i keep = _mm256_set1_epi8((char)0xFE);
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            int32_t word;
+            memcpy(&word, payload + i + 4 * k, 4);
+
+            // Broadcast 4 payload bytes, then repeat each one across 8 lanes
+            __m256i q = _mm256_shuffle_epi8(_mm256_set1_epi32(word), spread);
+            __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(q, bits), bits);
+            __m256i c = _mm256_loadu_si256((const __m256i *)(carrier + 8 * i + 32 * k));
+            c = _mm256_or_si256(_mm256_and_si256(c, keep), _mm256_and_si256(set, one));
+            _mm256_storeu_si256((__m256i *)(dst + 8 * i + 32 * k), c);
+        }
+    }
+    embed_scalar(dst + 8 * i, carrier + 8 * i, payload + i, len - i);
+}
+
+/* movemask collects bit 7 of each byte, so shift the LSBs up there first */
+LSB_TARGET("sse2")
+static void extract_sse2(unsigned char *payload, const unsigned char *carrier, size_t len)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            __m128i c = _mm_loadu_si128((const __m128i *)(carrier + 8 * i + 16 * k));
+            unsigned int mask = _mm_movemask_epi8(_mm_slli_epi16(c, 7));
+            payload[i + 2 * k] = mask;
+            payload[i + 2 * k + 1] = mask >> 8;
+        }
+    }
+    extract_scalar(payload + i, carrier + 8 * i, len - i);
+}
+
+/* 32 LSBs per movemask, 4 payload bytes at a time */
+LSB_TARGET("avx2")
+static void extract_avx2(unsigned char *payload, const unsigned char *carrier, size_t len)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32)
+    {
+        for (int k = 0; k < 8; k++)
+        {
+            __m256i c = _mm256_loadu_si256((const __m256i *)(carrier + 8 * i + 32 * k));
+            uint32_t mask = _mm256_movemask_epi8(_mm256_slli_epi16(c, 7));
+            memcpy(payload + i + 4 * k, &mask, 4);  // x86 is little endian
+        }
+    }
+    extract_scalar(payload + i, carrier + 8 * i, len - i);
+}
+
+static int sse2_supported(void)
+{
+    return __builtin_cpu_supports("sse2");
+}
+
+/* The avx2 entry uses the BMI2 depth kernels; every AVX2 CPU in practice has BMI2 */
+static int avx2_supported(void)
+{
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2");
+}
+
+#ifdef __x86_64__
+/* pdep scatters the 8 payload bits into the LSBs of one 64-bit carrier word */
+LSB_TARGET("bmi2")
+static void embed_bmi2(unsigned char *dst, const unsigned char *carrier,
+                       const unsigned char *payload, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint64_t c;
+        memcpy(&c, carrier + 8 * i, 8);
+        c = (c & ~LSB_MASK_64) | _pdep_u64(payload[i], LSB_MASK_64);
+        memcpy(dst + 8 * i, &c, 8);
+    }
+}
+
+/* pext gathers the LSBs of one 64-bit carrier word into a payload byte */
+LSB_TARGET("bmi2")
+static void extract_bmi2(unsigned char *payload, const unsigned char *carrier, size_t len)
+{
+    for (size_t i = 0; i < len; i++)
+    {
+        uint64_t c;
+        memcpy(&c, carrier + 8 * i, 8);
+        payload[i] = _pext_u64(c, LSB_MASK_64);
+    }
+}
+
+/* depth payload bytes fill one 64-bit carrier word, so pdep handles any depth */
+LSB_TARGET("bmi2")
+static void embed_depth_bmi2(unsigned char *dst, const unsigned char *carrier,
+                             const unsigned char *payload, size_t len, int depth)
+{
+    uint64_t mask = LSB_MASK_64 * ((1u << depth) - 1);
+    size_t i = 0, c = 0;
+
+    for (; i + depth <= len; i += depth, c += 8)
+    {
+        uint64_t bits = 0, w;
+        memcpy(&bits, payload + i, depth);
+        memcpy(&w, carrier + c, 8);
+        w = (w & ~mask) | _pdep_u64(bits, mask);
+        memcpy(dst + c, &w, 8);
+    }
+    embed_depth_scalar(dst + c, carrier + c, payload + i, len - i, depth);
+}
+
+LSB_TARGET("bmi2")
+static void extract_depth_bmi2(unsigned char *payload, const unsigned char *carrier,
+                               size_t len, int depth)
+{
+    uint64_t mask = LSB_MASK_64 * ((1u << depth) - 1);
+    size_t i = 0, c = 0;
+
+    for (; i + depth <= len; i += depth, c += 8)
+    {
+        uint64_t bits, w;
+        memcpy(&w, carrier + c, 8);
+        bits = _pext_u64(w, mask);
+        memcpy(payload + i, &bits, depth);
+    }
+    extract_depth_scalar(payload + i, carrier + c, len - i, depth);
+}
+
+static int bmi2_supported(void)
+{
+    return __builtin_cpu_supports("bmi2");
+}
+#endif
+
+#endif /* LSB_KERNEL_X86 */
+
+/* In order of preference */
+static const LsbKernel kernels[] =
+{
+#ifdef LSB_KERNEL_X86
+#ifdef __x86_64__
+    { "avx2", embed_avx2, extract_avx2, embed_depth_bmi2, extract_depth_bmi2, avx2_supported },
+    { "bmi2", embed_bmi2, extract_bmi2, embed_depth_bmi2, extract_depth_bmi2, bmi2_supported },
+#endif
+    { "sse2", embed_sse2, extract_sse2, embed_depth_scalar, extract_depth_scalar, sse2_supported },
+#endif
+    { "scalar", embed_scalar, extract_scalar, embed_depth_scalar, extract_depth_scalar, always_supported },
+};
+
+/* Read and set from any thread; release/acquire publishes the kernel with the pointer */
+static const LsbKernel *_Atomic active_kernel;
+
+void lsb_kernel_init(void)
+{
+    const LsbKernel *none = NULL;
+    size_t i;
+
+    if (atomic_load_explicit(&active_kernel, memory_order_acquire) != NULL)
+    {
+        return;
+    }
+#ifdef LSB_KERNEL_X86
+    __builtin_cpu_init();
+#endif
+    for (i = 0; !kernels[i].supported(); i++);  // scalar is always supported
+    // Racing first calls all pick the same kernel; one chosen by lsb_kernel_select meanwhile wins
+    atomic_compare_exchange_strong_explicit(&active_kernel, &none, &kernels[i],
+                                            memory_order_acq_rel, memory_order_acquire);
+}
+
+/* Kernel in use, picked on first call */
+static const LsbKernel *current_kernel(void)
+{
+    lsb_kernel_init();
+    return atomic_load_explicit(&active_kernel, memory_order_acquire);
+}
+
+Status lsb_kernel_select(const char *name)
+{
+#ifdef LSB_KERNEL_X86
+    __builtin_cpu_init();
+#endif
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); i++)
+    {
+        if (strcmp(kernels[i].name, name) == 0 && kernels[i].supported())
+        {
+            atomic_store_explicit(&active_kernel, &kernels[i], memory_order_release);
+            return e_success;
+        }
+    }
+    return e_failure;
+}
+
+const char *lsb_kernel_name(void)
+{
+    return current_kernel()->name;
+}
+
+void lsb_embed(unsigned char *dst, const unsigned char *carrier,
+               const unsigned char *payload, size_t len)
+{
+    current_kernel()->embed(dst, carrier, payload, len);
+}
+
+void lsb_extract(unsigned char *payload, const unsigned char *carrier, size_t len)
+{
+    current_kernel()->extract(payload, carrier, len);
+}
+
+size_t lsb_carrier_bytes(size_t len, int depth)
+{
+    return (8 * len + depth - 1) / depth;
+}
+
+void lsb_embed_depth(unsigned char *dst, const unsigned char *carrier,
+                     const unsigned char *payload, size_t len, int depth)
+{
+    const LsbKernel *kernel = current_kernel();
+
+    if (depth == 1)
+    {
+        kernel->embed(dst, carrier, payload, len);
+    }
+    else
+    {
+        kernel->embed_depth(dst, carrier, payload, len, depth);
+    }
+}
+
+void lsb_extract_depth(unsigned char *payload, const unsigned char *carrier, size_t len, int depth)
+{
+    const LsbKernel *kernel = current_kernel();
+
+    if (depth == 1)
+    {
+        kernel->extract(payload, carrier, len);
+    }
+    else
+    {
+        kernel->extract_depth(payload, carrier, len, depth);
+    }
+}
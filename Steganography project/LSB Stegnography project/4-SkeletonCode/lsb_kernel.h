@@ -0,0 +1,59 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef LSB_KERNEL_H
+#define LSB_KERNEL_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Bit-plane kernels shared by the encoder and decoder.
+ * Payload bit j of byte i goes to the LSB of carrier byte 8 * i + j,
+ * which is the layout encode_string has always produced.
+ * The best kernel for the running CPU is picked on first use.
+ *
+ * At depth k (1 to 4) the payload is one continuous bit
+ * stream, LSB first, stored k bits per carrier byte in its low k bits.
+ * k payload bytes fill exactly 8 carrier bytes; the last carrier byte
+ * of a call is padded with zero bits.
+ */
+
+typedef void (*lsb_embed_fn)(unsigned char *dst, const unsigned char *carrier,
+                             const unsigned char *payload, size_t len);
+typedef void (*lsb_extract_fn)(unsigned char *payload, const unsigned char *carrier, size_t len);
+typedef void (*lsb_embed_depth_fn)(unsigned char *dst, const unsigned char *carrier,
+                                   const unsigned char *payload, size_t len, int depth);
+typedef void (*lsb_extract_depth_fn)(unsigned char *payload, const unsigned char *carrier,
+                                     size_t len, int depth);
+
+/* Pick the fastest kernel supported by this CPU, unless one is already in use; thread safe */
+void lsb_kernel_init(void);
+
+/* Force a kernel by name ("scalar", "sse2", "bmi2", "avx2") */
+Status lsb_kernel_select(const char *name);
+
+/* Name of the kernel currently in use */
+const char *lsb_kernel_name(void);
+
+/* Embed len payload bytes into 8 * len carrier bytes; dst may equal carrier */
+void lsb_embed(unsigned char *dst, const unsigned char *carrier,
+               const unsigned char *payload, size_t len);
+
+/* Rebuild len payload bytes from the LSBs of 8 * len carrier bytes */
+void lsb_extract(unsigned char *payload, const unsigned char *carrier, size_t len);
+
+/* Carrier bytes needed for len payload bytes at depth bits per byte */
+size_t lsb_carrier_bytes(size_t len, int depth);
+
+/* Embed len payload bytes into lsb_carrier_bytes(len, depth) carrier bytes */
+void lsb_embed_depth(unsigned char *dst, const unsigned char *carrier,
+                     const unsigned char *payload, size_t len, int depth);
+
+/* Rebuild len payload bytes from lsb_carrier_bytes(len, depth) carrier bytes */
+void lsb_extract_depth(unsigned char *payload, const unsigned char *carrier, size_t len, int depth);
+
+#endif
@@ -0,0 +1,1125 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "lsb_steg.h"
+#include "lsb_kernel.h"
+#include "parallel.h"
+#include "lz_codec.h"
+#include "crc32c.h"
+
+/* Uncompressed secret bytes checksummed at a time, so the LSB pass finds them in cache */
+#define CRC_CHUNK (1024 * 1024)
+
+/* Name length, offset, size and CRC of one table of contents entry, around the name */
+#define TOC_ENTRY_FIXED (2 + 8 + 8 + 4)
+
+/* Length word and the longest magic string at 1 bit per byte, all that a probe reads */
+#define PROBE_CARRIER_BYTES ((4 + 9) * 8)
+
+
+/* Payload bytes per slab handed to a thread; 8x that in carrier bytes fits in L2 */
+#define SLAB_SIZE (32 * 1024)
+
+/* Carrier bytes gathered at a time from padded rows, a multiple of 8 */
+#define GATHER_SIZE 4096
+
+/* Read/write position inside the image buffer */
+typedef struct _StegCursor
+{
+    unsigned char *dst;         // Output image (NULL when decoding)
+    const unsigned char *src;   // Source image
+    const BmpInfo *bmp;         // Row layout of both images
+    size_t pos;                 // Next carrier byte
+    size_t size;                // Carrier bytes in the image
+    int num_threads;            // Threads used for large fields
+    int depth;                  // LSB bits per carrier byte for the next field
+    int wide;                   // Size words are 64-bit, see STEG_WIDE_VERSION
+} StegCursor;
+
+/* One embed/extract call split into slabs of whole depth-byte groups */
+typedef struct _SlabWork
+{
+    unsigned char *dst;
+    const unsigned char *src;
+    const BmpInfo *bmp;
+    size_t pos;                         // Carrier position of the first slab
+    const unsigned char *payload_in;    // Embed source
+    unsigned char *payload_out;         // Extract destination
+    size_t len;
+    size_t slab;                        // Payload bytes per slab, a multiple of depth
+    int depth;
+    uint *crcs;                         // CRC32C of each slab's payload, NULL when not wanted
+} SlabWork;
+
+/*
+ * Embed len payload bytes from carrier byte pos on. Rows without padding
+ * are one contiguous run; otherwise the carrier bytes are gathered into a
+ * small buffer and the file bytes between the end of carrier byte pos - 1
+ * and the last carrier byte are copied first, so padding comes through.
+ */
+static void embed_span(const BmpInfo *bmp, unsigned char *dst, const unsigned char *src, size_t pos,
+                       const unsigned char *payload, size_t len, int depth)
+{
+    unsigned char buf[GATHER_SIZE];
+    size_t max_chunk = GATHER_SIZE / 8 * depth;
+
+    if (bmp_is_contiguous(bmp))
+    {
+        size_t off = bmp->pixel_offset + pos;
+        lsb_embed_depth(dst + off, src + off, payload, len, depth);
+        return;
+    }
+
+    while (len > 0)
+    {
+        size_t chunk = len < max_chunk ? len : max_chunk;
+        size_t n = lsb_carrier_bytes(chunk, depth);
+        size_t start = bmp_carrier_end(bmp, pos);
+        size_t off = bmp_carrier_offset(bmp, pos);
+
+        memcpy(dst + start, src + start, bmp_carrier_end(bmp, pos + n) - start);
+        bmp_gather(bmp, pos, src + off, buf, n);
+        lsb_embed_depth(buf, buf, payload, chunk, depth);
+        bmp_scatter(bmp, pos, dst + off, buf, n);
+        pos += n;
+        payload += chunk;
+        len -= chunk;
+    }
+}
+
+static void extract_span(const BmpInfo *bmp, const unsigned char *src, size_t pos,
+                         unsigned char *payload, size_t len, int depth)
+{
+    unsigned char buf[GATHER_SIZE];
+    size_t max_chunk = GATHER_SIZE / 8 * depth;
+
+    if (bmp_is_contiguous(bmp))
+    {
+        lsb_extract_depth(payload, src + bmp->pixel_offset + pos, len, depth);
+        return;
+    }
+
+    while (len > 0)
+    {
+        size_t chunk = len < max_chunk ? len : max_chunk;
+        size_t n = lsb_carrier_bytes(chunk, depth);
+
+        bmp_gather(bmp, pos, src + bmp_carrier_offset(bmp, pos), buf, n);
+        lsb_extract_depth(payload, buf, chunk, depth);
+        pos += n;
+        payload += chunk;
+        len -= chunk;
+    }
+}
+
+static size_t slab_len(const SlabWork *work, size_t job)
+{
+    size_t off = job * work->slab;
+    return work->len - off < work->slab ? work->len - off : work->slab;
+}
+
+static void embed_slab(size_t job, void *arg)
+{
+    SlabWork *work = arg;
+    size_t off = job * work->slab;
+    size_t carrier_off = off * 8 / work->depth;  // Exact, slabs are whole groups
+
+    if (work->crcs != NULL)
+    {
+        work->crcs[job] = crc32c_update(0, work->payload_in + off, slab_len(work, job));
+    }
+    embed_span(work->bmp, work->dst, work->src, work->pos + carrier_off, work->payload_in + off,
+               slab_len(work, job), work->depth);
+}
+
+static void extract_slab(size_t job, void *arg)
+{
+    SlabWork *work = arg;
+    size_t off = job * work->slab;
+    size_t carrier_off = off * 8 / work->depth;
+
+    extract_span(work->bmp, work->src, work->pos + carrier_off, work->payload_out + off,
+                 slab_len(work, job), work->depth);
+    if (work->crcs != NULL)
+    {
+        work->crcs[job] = crc32c_update(0, work->payload_out + off, slab_len(work, job));
+    }
+}
+
+/*
+ * Run fn over every slab of work. With crc, each slab checksums its own
+ * payload while it is in cache and the results are folded into *crc in
+ * payload order, so the checksum scales with the threads too.
+ */
+static Status run_slabs(StegCursor *cur, SlabWork *work, parallel_fn fn, uint *crc)
+{
+    size_t njobs = (work->len + work->slab - 1) / work->slab;
+    Status ret;
+
+    if (crc != NULL)
+    {
+        work->crcs = malloc(njobs * sizeof(*work->crcs));
+        if (work->crcs == NULL)
+        {
+            steg_set_error("Out of memory");
+            return e_failure;
+        }
+    }
+    ret = run_parallel(cur->num_threads, njobs, fn, work);
+    for (size_t job = 0; ret == e_success && crc != NULL && job < njobs; job++)
+    {
+        *crc = crc32c_combine(*crc, work->crcs[job], slab_len(work, job));
+    }
+    free(work->crcs);
+    return ret;
+}
+
+/* Embed len payload bytes, adding them to *crc unless crc is NULL */
+static Status cursor_embed_crc(StegCursor *cur, const unsigned char *payload, size_t len, uint *crc)
+{
+    size_t n = lsb_carrier_bytes(len, cur->depth);
+
+    if (n > cur->size - cur->pos)
+    {
+        steg_set_error("Source image is too small for the secret data");
+        return e_failure;
+    }
+    if (cur->num_threads > 1 && len > SLAB_SIZE)
+    {
+        // Every slab owns a disjoint carrier window, so the output does not depend on scheduling
+        SlabWork work = { cur->dst, cur->src, cur->bmp, cur->pos, payload, NULL, len,
+                          SLAB_SIZE - SLAB_SIZE % cur->depth, cur->depth, NULL };
+        if (run_slabs(cur, &work, embed_slab, crc) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    else
+    {
+        if (crc != NULL)
+        {
+            *crc = crc32c_update(*crc, payload, len);
+        }
+        embed_span(cur->bmp, cur->dst, cur->src, cur->pos, payload, len, cur->depth);
+    }
+    cur->pos += n;
+    return e_success;
+}
+
+static Status cursor_embed(StegCursor *cur, const unsigned char *payload, size_t len)
+{
+    return cursor_embed_crc(cur, payload, len, NULL);
+}
+
+static Status cursor_embed_length(StegCursor *cur, uint len)
+{
+    unsigned char bytes[4] = { len, len >> 8, len >> 16, len >> 24 };  // Same layout as encode_length
+    return cursor_embed(cur, bytes, 4);
+}
+
+/* Embed a size word, 64-bit from STEG_WIDE_VERSION on */
+static Status cursor_embed_size(StegCursor *cur, unsigned long long size)
+{
+    unsigned char bytes[STEG_SIZE_BYTES];
+
+    for (int i = 0; i < STEG_SIZE_BYTES; i++)
+    {
+        bytes[i] = size >> (8 * i);
+    }
+    return cursor_embed(cur, bytes, cur->wide ? STEG_SIZE_BYTES : 4);
+}
+
+/* Extract len payload bytes, adding them to *crc unless crc is NULL */
+static Status cursor_extract_crc(StegCursor *cur, unsigned char *payload, size_t len, uint *crc)
+{
+    size_t n = lsb_carrier_bytes(len, cur->depth);
+
+    if (n > cur->size - cur->pos)
+    {
+        steg_set_error("Stego image ended while decoding");
+        return e_failure;
+    }
+    if (cur->num_threads > 1 && len > SLAB_SIZE)
+    {
+        SlabWork work = { NULL, cur->src, cur->bmp, cur->pos, NULL, payload, len,
+                          SLAB_SIZE - SLAB_SIZE % cur->depth, cur->depth, NULL };
+        if (run_slabs(cur, &work, extract_slab, crc) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    else
+    {
+        extract_span(cur->bmp, cur->src, cur->pos, payload, len, cur->depth);
+        if (crc != NULL)
+        {
+            *crc = crc32c_update(*crc, payload, len);
+        }
+    }
+    cur->pos += n;
+    return e_success;
+}
+
+static Status cursor_extract(StegCursor *cur, unsigned char *payload, size_t len)
+{
+    return cursor_extract_crc(cur, payload, len, NULL);
+}
+
+static Status cursor_extract_length(StegCursor *cur, uint *len)
+{
+    unsigned char bytes[4];
+
+    if (cursor_extract(cur, bytes, 4) == e_failure)
+    {
+        return e_failure;
+    }
+    *len = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint)bytes[3] << 24);
+    return e_success;
+}
+
+static Status cursor_extract_size(StegCursor *cur, unsigned long long *size)
+{
+    unsigned char bytes[STEG_SIZE_BYTES];
+    int n = cur->wide ? STEG_SIZE_BYTES : 4;
+
+    if (cursor_extract(cur, bytes, n) == e_failure)
+    {
+        return e_failure;
+    }
+    *size = 0;
+    for (int i = n - 1; i >= 0; i--)
+    {
+        *size = *size << 8 | bytes[i];
+    }
+    return e_success;
+}
+
+/* Embed the secret as LZ blocks, each behind its block word like encode_secret_file_data */
+static Status cursor_embed_lz(StegCursor *cur, const unsigned char *secret, size_t len, uint *crc,
+                              StegStats *stats)
+{
+    unsigned char buf[LZ_BLOCK_SIZE];
+    size_t stored = 0;
+
+    for (size_t off = 0; off < len; off += LZ_BLOCK_SIZE)
+    {
+        int chunk = len - off < LZ_BLOCK_SIZE ? len - off : LZ_BLOCK_SIZE;
+        int size = lz_compress_block(secret + off, chunk, buf, chunk - 1);
+
+        *crc = crc32c_update(*crc, secret + off, chunk);
+        if (size < 0 ? cursor_embed_length(cur, chunk | LZ_BLOCK_RAW) == e_failure ||
+                       cursor_embed(cur, secret + off, chunk) == e_failure
+                     : cursor_embed_length(cur, size) == e_failure || cursor_embed(cur, buf, size) == e_failure)
+        {
+            return e_failure;
+        }
+        stored += size < 0 ? chunk : size;
+    }
+    if (stats != NULL)
+    {
+        stats->compressed = stored;
+    }
+    return e_success;
+}
+
+/* Extract LZ blocks and decompress them straight into the output buffer */
+static Status cursor_extract_lz(StegCursor *cur, unsigned char *out, size_t len, uint *crc)
+{
+    unsigned char buf[LZ_BLOCK_SIZE];
+    uint word;
+
+    for (size_t off = 0; off < len; off += LZ_BLOCK_SIZE)
+    {
+        int chunk = len - off < LZ_BLOCK_SIZE ? len - off : LZ_BLOCK_SIZE;
+        int size;
+
+        if (cursor_extract_length(cur, &word) == e_failure)
+        {
+            return e_failure;
+        }
+        size = word & ~LZ_BLOCK_RAW;
+        if (word & LZ_BLOCK_RAW ? size != chunk || cursor_extract(cur, out + off, chunk) == e_failure
+                                : size > LZ_BLOCK_SIZE || cursor_extract(cur, buf, size) == e_failure ||
+                                  lz_decompress_block(buf, size, out + off, chunk) != chunk)
+        {
+            steg_set_error("Corrupt compressed block");
+            return e_failure;
+        }
+        *crc = crc32c_update(*crc, out + off, chunk);
+    }
+    return e_success;
+}
+
+/*
+ * Embed uncompressed data, checksumming each chunk just before it is
+ * embedded. With threads the slabs checksum themselves in one pass.
+ */
+static Status cursor_embed_chunks(StegCursor *cur, const unsigned char *data, size_t len, uint *crc)
+{
+    size_t max_chunk = CRC_CHUNK - CRC_CHUNK % cur->depth;  // Whole depth-byte groups, so chunks join seamlessly
+
+    if (cur->num_threads > 1)
+    {
+        return cursor_embed_crc(cur, data, len, crc);
+    }
+    for (size_t off = 0; off < len; off += max_chunk)
+    {
+        size_t chunk = len - off < max_chunk ? len - off : max_chunk;
+        if (cursor_embed_crc(cur, data + off, chunk, crc) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    return e_success;
+}
+
+/* Extract uncompressed data, checksumming each chunk just after it is extracted */
+static Status cursor_extract_chunks(StegCursor *cur, unsigned char *out, size_t len, uint *crc)
+{
+    size_t max_chunk = CRC_CHUNK - CRC_CHUNK % cur->depth;
+
+    if (cur->num_threads > 1)
+    {
+        return cursor_extract_crc(cur, out, len, crc);
+    }
+    for (size_t off = 0; off < len; off += max_chunk)
+    {
+        size_t chunk = len - off < max_chunk ? len - off : max_chunk;
+        if (cursor_extract_crc(cur, out + off, chunk, crc) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    return e_success;
+}
+
+/* Embed the secret data and its FORMAT_CRC trailer */
+static Status cursor_embed_data(StegCursor *cur, const unsigned char *secret, size_t len, int codec,
+                                StegStats *stats)
+{
+    uint crc = 0;
+
+    if ((codec == CODEC_LZ ? cursor_embed_lz(cur, secret, len, &crc, stats)
+                           : cursor_embed_chunks(cur, secret, len, &crc)) == e_failure)
+    {
+        return e_failure;
+    }
+    return cursor_embed_length(cur, crc);
+}
+
+/* Extract the secret data and check it against the FORMAT_CRC trailer when there is one */
+static Status cursor_extract_data(StegCursor *cur, unsigned char *out, size_t len, int codec, int has_crc)
+{
+    uint crc = 0, stored;
+
+    if ((codec == CODEC_LZ ? cursor_extract_lz(cur, out, len, &crc)
+                           : cursor_extract_chunks(cur, out, len, &crc)) == e_failure)
+    {
+        return e_failure;
+    }
+    if (has_crc && (cursor_extract_length(cur, &stored) == e_failure || stored != crc))
+    {
+        steg_set_error("Secret data checksum does not match, the image is damaged");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Image bytes up to the cursor count as both read and written when encoding */
+static void embed_phase(StegStats *stats, const char *name, const StegCursor *cur, long long secret_read)
+{
+    long long img = bmp_carrier_end(cur->bmp, cur->pos);
+    stats_phase(stats, name, img + secret_read, img, cur->pos);
+}
+
+/* Embed the shard words that follow the format word */
+static Status cursor_embed_shard(StegCursor *cur, const StegShard *shard)
+{
+    return cursor_embed_length(cur, shard->set_id) == e_failure ||
+           cursor_embed_length(cur, shard->index | (shard->count << 16)) == e_failure ||
+           cursor_embed_size(cur, shard->offset) == e_failure ||
+           cursor_embed_size(cur, shard->total_size) == e_failure ? e_failure : e_success;
+}
+
+/* Check the options, copy the BMP headers and embed the magic string and format word */
+static Status embed_header(StegCursor *cur, BmpInfo *bmp, const unsigned char *image, size_t image_size,
+                           const char *magic, int depth, uint flags, const StegOptions *opts,
+                           unsigned char *out, StegStats *stats)
+{
+    uint mask = opts != NULL ? opts->channel_mask : 0;
+
+    if (strlen(magic) == 0 || strlen(magic) >= 10 || depth > MAX_LSB_DEPTH)
+    {
+        steg_set_error("Invalid magic string, extension or LSB depth");
+        return e_failure;
+    }
+    stats_phase(stats, "header", 0, 0, 0);
+    if (parse_bmp_info(image, image_size, image_size, bmp) == e_failure ||
+        bmp_check_channels(bmp, &mask) == e_failure)
+    {
+        return e_failure;
+    }
+
+    cur->dst = out;
+    cur->src = image;
+    cur->bmp = bmp;
+    cur->pos = 0;
+    cur->size = bmp->carrier_size;
+    cur->num_threads = opts != NULL ? opts->num_threads : 1;
+    cur->depth = 1;  // Magic string and format word are 1 bit per byte
+    cur->wide = 1;
+    lsb_kernel_init();  // Pick the kernel before any worker thread uses it
+
+    memcpy(out, image, bmp->pixel_offset);  // Copy everything before the pixel array
+    embed_phase(stats, "magic", cur, 0);
+
+    // Same header as encode_magic_string and encode_header_format
+    if (cursor_embed_length(cur, strlen(magic) | (STEG_HEADER_VERSION << 8)) == e_failure ||
+        cursor_embed(cur, (const unsigned char *)magic, strlen(magic)) == e_failure ||
+        cursor_embed_length(cur, depth | flags | FORMAT_CRC | (mask << FORMAT_CHANNEL_SHIFT)) == e_failure)
+    {
+        return e_failure;
+    }
+    if (mask != 0)
+    {
+        // The narrowed carrier starts on a new row, the rest of this one is copied as is
+        size_t end = bmp_carrier_end(bmp, cur->pos);
+        if (bmp_set_channels(bmp, cur->pos, mask) == e_failure)
+        {
+            return e_failure;
+        }
+        memcpy(out + end, image + end, (bmp->pixel_offset < image_size ? bmp->pixel_offset : image_size) - end);
+        cur->size = bmp->carrier_size;
+    }
+    cur->depth = depth;
+    return e_success;
+}
+
+/* Copy the image bytes after the last carrier byte written */
+static void embed_tail(StegCursor *cur, const unsigned char *image, size_t image_size, unsigned char *out,
+                       size_t secret_size, StegStats *stats)
+{
+    size_t tail = bmp_carrier_end(cur->bmp, cur->pos);
+
+    embed_phase(stats, "copy_tail", cur, secret_size);
+    memcpy(out + tail, image + tail, image_size - tail);
+    stats_phase(stats, NULL, image_size + secret_size, image_size, cur->pos);
+}
+
+/*
+ * Hide secret, which is the whole secret or the part that shard describes.
+ * With prefix_size the image after the last carrier byte written is left
+ * out and *prefix_size says where it starts.
+ */
+static Status embed_image(const unsigned char *image, size_t image_size,
+                          const unsigned char *secret, size_t secret_size, const StegShard *shard,
+                          const char *extn, const char *magic, const StegOptions *opts,
+                          unsigned char *out, size_t *prefix_size, StegStats *stats)
+{
+    BmpInfo bmp;
+    StegCursor cur;
+    int depth = opts != NULL && opts->lsb_depth > 0 ? opts->lsb_depth : 1;
+    int codec = opts != NULL && opts->compress ? CODEC_LZ : CODEC_NONE;
+
+    if (strlen(extn) >= STEG_MAX_EXTN)
+    {
+        steg_set_error("Invalid magic string, extension or LSB depth");
+        return e_failure;
+    }
+    if (embed_header(&cur, &bmp, image, image_size, magic, depth,
+                     (codec << FORMAT_CODEC_SHIFT) | (shard != NULL ? FORMAT_SHARD : 0), opts, out, stats) == e_failure)
+    {
+        return e_failure;
+    }
+    if (shard != NULL && cursor_embed_shard(&cur, shard) == e_failure)
+    {
+        return e_failure;
+    }
+
+    embed_phase(stats, "extn", &cur, 0);
+    if (cursor_embed_length(&cur, strlen(extn)) == e_failure ||
+        cursor_embed(&cur, (const unsigned char *)extn, strlen(extn)) == e_failure)
+    {
+        return e_failure;
+    }
+    embed_phase(stats, "data", &cur, 0);
+    if (cursor_embed_size(&cur, secret_size) == e_failure ||
+        cursor_embed_data(&cur, secret, secret_size, codec, stats) == e_failure)
+    {
+        return e_failure;
+    }
+    if (prefix_size != NULL)
+    {
+        *prefix_size = bmp_carrier_end(&bmp, cur.pos);
+        return e_success;
+    }
+    embed_tail(&cur, image, image_size, out, secret_size, stats);
+    return e_success;
+}
+
+Status steg_embed(const unsigned char *image, size_t image_size,
+                  const unsigned char *secret, size_t secret_size,
+                  const char *extn, const char *magic, const StegOptions *opts,
+                  unsigned char *out, StegStats *stats)
+{
+    return embed_image(image, image_size, secret, secret_size, NULL, extn, magic, opts, out, NULL, stats);
+}
+
+Status steg_embed_prefix(const unsigned char *image, size_t image_size,
+                         const unsigned char *secret, size_t secret_size,
+                         const char *extn, const char *magic, const StegOptions *opts,
+                         unsigned char *out, size_t *prefix_size)
+{
+    return embed_image(image, image_size, secret, secret_size, NULL, extn, magic, opts, out, prefix_size, NULL);
+}
+
+Status steg_embed_shard(const unsigned char *image, size_t image_size, const unsigned char *secret,
+                        const StegShard *shard, const char *extn, const char *magic,
+                        const StegOptions *opts, unsigned char *out, StegStats *stats)
+{
+    if (shard->count < 1 || shard->count > STEG_MAX_SHARDS || shard->index >= shard->count ||
+        shard->offset > shard->total_size || shard->size > shard->total_size - shard->offset)
+    {
+        steg_set_error("Invalid shard");
+        return e_failure;
+    }
+    return embed_image(image, image_size, secret + shard->offset, shard->size, shard, extn, magic,
+                       opts, out, NULL, stats);
+}
+
+/* Longest payload that fits in n carrier bytes */
+static size_t carrier_payload(size_t n, int depth)
+{
+    return n * depth / 8;
+}
+
+size_t steg_capacity(size_t carrier_size, size_t magic_len, size_t extn_len,
+                     const StegOptions *opts, int sharded)
+{
+    int depth = opts != NULL && opts->lsb_depth > 0 ? opts->lsb_depth : 1;
+    size_t word = lsb_carrier_bytes(4, depth);
+    size_t size_word = lsb_carrier_bytes(STEG_SIZE_BYTES, depth);
+    size_t used = 2 * lsb_carrier_bytes(4, 1) + lsb_carrier_bytes(magic_len, 1) +  // Length word, magic, format word
+                  (sharded ? STEG_SHARD_WORDS * word + 2 * size_word : 0) +
+                  word + lsb_carrier_bytes(extn_len, depth) + size_word + word;  // Extension, data length and CRC
+    size_t avail;
+
+    if (used >= carrier_size)
+    {
+        return 0;
+    }
+    avail = carrier_size - used;
+    if (opts != NULL && opts->compress)
+    {
+        // Every block stored raw behind its block word
+        size_t block = word + lsb_carrier_bytes(LZ_BLOCK_SIZE, depth);
+        size_t rest = avail % block;
+        return avail / block * LZ_BLOCK_SIZE + (rest > word ? carrier_payload(rest - word, depth) : 0);
+    }
+    return carrier_payload(avail, depth);
+}
+
+static void put_le(unsigned char *p, unsigned long long value, int nbytes)
+{
+    for (int i = 0; i < nbytes; i++)
+    {
+        p[i] = value >> (8 * i);
+    }
+}
+
+static unsigned long long get_le(const unsigned char *p, int nbytes)
+{
+    unsigned long long value = 0;
+
+    for (int i = nbytes - 1; i >= 0; i--)
+    {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+/* Payload offset rounded up to whole depth-byte groups, which start on a carrier byte */
+static size_t group_align(size_t offset, int depth)
+{
+    return (offset + depth - 1) / depth * depth;
+}
+
+Status steg_embed_archive(const unsigned char *image, size_t image_size, const StegFile *files, size_t nfiles,
+                          const char *magic, const StegOptions *opts, unsigned char *out, StegStats *stats)
+{
+    BmpInfo bmp;
+    StegCursor cur;
+    int depth = opts != NULL && opts->lsb_depth > 0 ? opts->lsb_depth : 1;
+    size_t toc_size = 0, data_size = 0, data_pos;
+    unsigned char *toc, *entry;
+    uint toc_crc = 0;
+    Status ret = e_failure;
+
+    if (opts != NULL && opts->compress)
+    {
+        steg_set_error("Archives are stored uncompressed so that files can be extracted on their own");
+        return e_failure;
+    }
+    for (size_t i = 0; i < nfiles; i++)
+    {
+        size_t len = strlen(files[i].name);
+        if (len == 0 || len >= STEG_MAX_NAME)
+        {
+            steg_set_error("Invalid file name");
+            return e_failure;
+        }
+        toc_size += TOC_ENTRY_FIXED + len;
+        data_size = group_align(data_size, depth) + files[i].size;
+    }
+    if (nfiles > UINT_MAX || toc_size > UINT_MAX)
+    {
+        steg_set_error("Archive is too large");
+        return e_failure;
+    }
+    toc = malloc(toc_size > 0 ? toc_size : 1);
+    if (toc == NULL)
+    {
+        steg_set_error("Out of memory");
+        return e_failure;
+    }
+    if (embed_header(&cur, &bmp, image, image_size, magic, depth, FORMAT_ARCHIVE, opts, out, stats) == e_failure)
+    {
+        goto done;
+    }
+
+    // Entry count, TOC size, TOC, TOC CRC and data length come before the data
+    data_pos = cur.pos + 3 * lsb_carrier_bytes(4, depth) + lsb_carrier_bytes(toc_size, depth) +
+               lsb_carrier_bytes(STEG_SIZE_BYTES, depth);
+    if (data_pos > cur.size || lsb_carrier_bytes(data_size, depth) > cur.size - data_pos)
+    {
+        steg_set_error("Source image is too small for the secret data");
+        goto done;
+    }
+
+    // The data goes in first, so each entry gets the CRC computed while embedding its file
+    size_t header_pos = cur.pos, offset = 0;
+    cur.pos = data_pos;
+    embed_phase(stats, "data", &cur, 0);
+    entry = toc;
+    for (size_t i = 0; i < nfiles; i++)
+    {
+        size_t len = strlen(files[i].name);
+        size_t tail = files[i].size % depth, body = files[i].size - tail;
+        unsigned char group[MAX_LSB_DEPTH] = { 0 };
+        uint crc = 0;
+
+        // A partial last group is padded with zeros so the next file starts on a group
+        if (tail > 0)
+        {
+            memcpy(group, files[i].data + body, tail);
+        }
+        if (cursor_embed_chunks(&cur, files[i].data, body, &crc) == e_failure ||
+            cursor_embed(&cur, group, i + 1 < nfiles && tail > 0 ? (size_t)depth : tail) == e_failure)
+        {
+            goto done;
+        }
+        crc = crc32c_update(crc, group, tail);
+        put_le(entry, len, 2);
+        memcpy(entry + 2, files[i].name, len);
+        put_le(entry + 2 + len, offset, 8);
+        put_le(entry + 2 + len + 8, files[i].size, 8);
+        put_le(entry + 2 + len + 16, crc, 4);
+        entry += TOC_ENTRY_FIXED + len;
+        offset = group_align(offset + files[i].size, depth);
+    }
+    size_t end_pos = cur.pos;
+
+    cur.pos = header_pos;
+    embed_phase(stats, "toc", &cur, 0);
+    toc_crc = crc32c_update(0, toc, toc_size);
+    if (cursor_embed_length(&cur, nfiles) == e_failure || cursor_embed_length(&cur, toc_size) == e_failure ||
+        cursor_embed(&cur, toc, toc_size) == e_failure || cursor_embed_length(&cur, toc_crc) == e_failure ||
+        cursor_embed_size(&cur, data_size) == e_failure)
+    {
+        goto done;
+    }
+    cur.pos = end_pos;
+    embed_tail(&cur, image, image_size, out, data_size, stats);
+    ret = e_success;
+done:
+    free(toc);
+    return ret;
+}
+
+Status steg_read_toc(const unsigned char *image, size_t image_size, const StegHeader *hdr, StegEntry *entries)
+{
+    StegCursor cur;
+    unsigned char *toc, *entry;
+    uint stored;
+    Status ret = e_failure;
+
+    if (!hdr->is_archive || hdr->bmp.file_size != image_size)
+    {
+        steg_set_error("Header does not belong to an archive in this image");
+        return e_failure;
+    }
+    toc = malloc(hdr->toc_size > 0 ? hdr->toc_size : 1);
+    if (toc == NULL)
+    {
+        steg_set_error("Out of memory");
+        return e_failure;
+    }
+    cur.dst = NULL;
+    cur.src = image;
+    cur.bmp = &hdr->bmp;
+    cur.pos = hdr->toc_pos;
+    cur.size = hdr->bmp.carrier_size;
+    cur.num_threads = 1;
+    cur.depth = hdr->lsb_depth;
+    if (cursor_extract(&cur, toc, hdr->toc_size) == e_failure || cursor_extract_length(&cur, &stored) == e_failure)
+    {
+        goto done;
+    }
+    if (stored != crc32c_update(0, toc, hdr->toc_size))
+    {
+        steg_set_error("Table of contents checksum does not match, the image is damaged");
+        goto done;
+    }
+
+    entry = toc;
+    for (size_t i = 0; i < hdr->archive_entries; i++)
+    {
+        size_t left = toc + hdr->toc_size - entry;
+        size_t len = left >= TOC_ENTRY_FIXED ? get_le(entry, 2) : 0;
+
+        if (len == 0 || len >= STEG_MAX_NAME || TOC_ENTRY_FIXED + len > left)
+        {
+            steg_set_error("Invalid table of contents");
+            goto done;
+        }
+        memcpy(entries[i].name, entry + 2, len);
+        entries[i].name[len] = '\0';
+        entries[i].offset = get_le(entry + 2 + len, 8);
+        entries[i].size = get_le(entry + 2 + len + 8, 8);
+        entries[i].crc = get_le(entry + 2 + len + 16, 4);
+        if (entries[i].offset % hdr->lsb_depth != 0 || entries[i].offset > hdr->secret_size ||
+            entries[i].size > hdr->secret_size - entries[i].offset)
+        {
+            steg_set_error("Invalid table of contents");
+            goto done;
+        }
+        entry += TOC_ENTRY_FIXED + len;
+    }
+    ret = e_success;
+done:
+    free(toc);
+    return ret;
+}
+
+Status steg_extract_range(const unsigned char *image, size_t image_size, const StegHeader *hdr,
+                          const StegEntry *entry, size_t offset, size_t len, const StegOptions *opts,
+                          unsigned char *out)
+{
+    StegCursor cur;
+    size_t start = entry->offset + offset;
+    size_t head = start % hdr->lsb_depth;  // Bytes before start in its depth-byte group
+
+    if (!hdr->is_archive || hdr->bmp.file_size != image_size || offset > entry->size || len > entry->size - offset)
+    {
+        steg_set_error("Range is outside the file");
+        return e_failure;
+    }
+    cur.dst = NULL;
+    cur.src = image;
+    cur.bmp = &hdr->bmp;
+    cur.pos = hdr->data_pos + lsb_carrier_bytes(start - head, hdr->lsb_depth);  // Exact, start - head is whole groups
+    cur.size = hdr->bmp.carrier_size;
+    cur.num_threads = opts != NULL ? opts->num_threads : 1;
+    cur.depth = hdr->lsb_depth;
+    lsb_kernel_init();
+
+    // The whole file is checked against its CRC as it is extracted
+    if (offset == 0 && len == entry->size && hdr->has_crc)
+    {
+        uint crc = 0;
+        if (cursor_extract_chunks(&cur, out, len, &crc) == e_failure)
+        {
+            return e_failure;
+        }
+        if (crc != entry->crc)
+        {
+            steg_set_error("File checksum does not match, the image is damaged");
+            return e_failure;
+        }
+        return e_success;
+    }
+    if (head > 0 && len > 0)
+    {
+        unsigned char group[MAX_LSB_DEPTH];
+        size_t n = hdr->lsb_depth - head < len ? hdr->lsb_depth - head : len;
+
+        if (cursor_extract(&cur, group, head + n) == e_failure)
+        {
+            return e_failure;
+        }
+        memcpy(out, group + head, n);
+        out += n;
+        len -= n;
+    }
+    return cursor_extract(&cur, out, len);
+}
+
+/* Decode and compare the magic string from the first carrier byte, its length word also holds the header version */
+static Status decode_magic(StegCursor *cur, const char *magic, StegHeader *hdr)
+{
+    char str[10];
+    uint len;
+
+    cur->pos = 0;
+    cur->size = hdr->bmp.carrier_size;
+    cur->depth = 1;  // Magic string and format word are 1 bit per byte
+    hdr->version = 0;
+
+    if (cursor_extract_length(cur, &len) == e_failure || (len & 0xFF) >= sizeof(str) ||
+        (len >> 8) > STEG_HEADER_VERSION ||
+        cursor_extract(cur, (unsigned char *)str, len & 0xFF) == e_failure)
+    {
+        return e_failure;
+    }
+    str[len & 0xFF] = '\0';
+    if (strcmp(str, magic) != 0)
+    {
+        return e_failure;
+    }
+    hdr->version = len >> 8;
+    return e_success;
+}
+
+/* Find the magic string in the row layout, or in the raw layout of images written before rows were parsed */
+static Status find_magic(StegCursor *cur, const unsigned char *image, const char *magic, StegHeader *hdr)
+{
+    Status ret;
+
+    cur->dst = NULL;
+    cur->src = image;
+    cur->bmp = &hdr->bmp;
+    cur->num_threads = 1;
+
+    // Same fallback as do_decoding
+    ret = decode_magic(cur, magic, hdr);
+    if ((ret == e_failure || hdr->version < STEG_ROW_LAYOUT_VERSION) && !bmp_is_raw_layout(&hdr->bmp))
+    {
+        bmp_set_raw_layout(&hdr->bmp);
+        ret = decode_magic(cur, magic, hdr);
+    }
+    if (ret == e_failure)
+    {
+        steg_set_error("Magic String not matching");
+    }
+    return ret;
+}
+
+/* Extract the shard words, the size comes later from the data length */
+static Status cursor_extract_shard(StegCursor *cur, StegShard *shard)
+{
+    uint word[STEG_SHARD_WORDS];
+    unsigned long long offset, total_size;
+
+    for (int i = 0; i < STEG_SHARD_WORDS; i++)
+    {
+        if (cursor_extract_length(cur, &word[i]) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    if (cursor_extract_size(cur, &offset) == e_failure || cursor_extract_size(cur, &total_size) == e_failure)
+    {
+        return e_failure;
+    }
+    shard->set_id = word[0];
+    shard->index = word[1] & 0xFFFF;
+    shard->count = word[1] >> 16;
+    shard->offset = offset;
+    shard->total_size = total_size;
+    if (shard->count == 0 || shard->index >= shard->count || offset > total_size || (size_t)total_size != total_size)
+    {
+        steg_set_error("Invalid shard");
+        return e_failure;
+    }
+    return e_success;
+}
+
+size_t steg_probe_size(const unsigned char *head, size_t file_size)
+{
+    BmpInfo bmp;
+    size_t rows, raw = BMP_HEADER_SIZE + PROBE_CARRIER_BYTES;
+
+    if (parse_bmp_info(head, BMP_HEADER_SIZE, file_size, &bmp) == e_failure)
+    {
+        return 0;
+    }
+    rows = bmp_carrier_end(&bmp, bmp.carrier_size < PROBE_CARRIER_BYTES ? bmp.carrier_size : PROBE_CARRIER_BYTES);
+    rows = rows > raw ? rows : raw;
+    return rows < file_size ? rows : file_size;
+}
+
+Status steg_probe(const unsigned char *head, size_t head_size, size_t file_size, const char *magic)
+{
+    StegHeader hdr;
+    StegCursor cur;
+    size_t need = steg_probe_size(head, file_size);
+
+    if (need == 0)
+    {
+        return e_failure;
+    }
+    if (head_size < need)
+    {
+        steg_set_error("Not enough of the image to probe");
+        return e_failure;
+    }
+    // The cursor only reaches PROBE_CARRIER_BYTES into either layout, all of it inside head
+    parse_bmp_info(head, head_size, file_size, &hdr.bmp);
+    return find_magic(&cur, head, magic, &hdr);
+}
+
+Status steg_read_header(const unsigned char *image, size_t image_size, const char *magic,
+                        StegHeader *hdr, StegStats *stats)
+{
+    StegCursor cur;
+    uint len;
+    unsigned long long size;
+
+    stats_phase(stats, "header", 0, 0, 0);
+    if (parse_bmp_info(image, image_size, image_size, &hdr->bmp) == e_failure)
+    {
+        return e_failure;
+    }
+
+    stats_phase(stats, "magic", hdr->bmp.pixel_offset, 0, 0);
+    if (find_magic(&cur, image, magic, hdr) == e_failure)
+    {
+        return e_failure;
+    }
+
+    // Images without a header version are always 1 bit per byte and uncompressed
+    cur.wide = hdr->version >= STEG_WIDE_VERSION;
+    hdr->codec = CODEC_NONE;
+    hdr->has_crc = 0;
+    hdr->is_archive = 0;
+    hdr->archive_entries = 0;
+    memset(&hdr->shard, 0, sizeof(hdr->shard));
+    if (hdr->version > 0)
+    {
+        if (cursor_extract_length(&cur, &len) == e_failure ||
+            (len & FORMAT_DEPTH_MASK) < 1 || (len & FORMAT_DEPTH_MASK) > MAX_LSB_DEPTH ||
+            (len & FORMAT_CODEC_MASK) >> FORMAT_CODEC_SHIFT > CODEC_LZ)
+        {
+            steg_set_error("Unsupported header format");
+            return e_failure;
+        }
+        cur.depth = len & FORMAT_DEPTH_MASK;
+        hdr->codec = (len & FORMAT_CODEC_MASK) >> FORMAT_CODEC_SHIFT;
+        hdr->has_crc = (len & FORMAT_CRC) != 0;
+        hdr->is_archive = (len & FORMAT_ARCHIVE) != 0;
+        if ((len & FORMAT_CHANNEL_MASK) != 0)
+        {
+            if (bmp_set_channels(&hdr->bmp, cur.pos, (len & FORMAT_CHANNEL_MASK) >> FORMAT_CHANNEL_SHIFT) == e_failure)
+            {
+                return e_failure;
+            }
+            cur.size = hdr->bmp.carrier_size;
+        }
+        if ((len & FORMAT_SHARD) && cursor_extract_shard(&cur, &hdr->shard) == e_failure)
+        {
+            return e_failure;
+        }
+    }
+    hdr->lsb_depth = cur.depth;
+
+    if (hdr->is_archive)
+    {
+        // Skip the table of contents, steg_read_toc reads it
+        uint count, toc_size;
+        stats_phase(stats, "toc", bmp_carrier_end(cur.bmp, cur.pos), 0, cur.pos);
+        if (hdr->codec != CODEC_NONE || cursor_extract_length(&cur, &count) == e_failure ||
+            cursor_extract_length(&cur, &toc_size) == e_failure || (size_t)count * TOC_ENTRY_FIXED > toc_size ||
+            lsb_carrier_bytes(toc_size, cur.depth) + lsb_carrier_bytes(4, cur.depth) > cur.size - cur.pos)
+        {
+            steg_set_error("Invalid table of contents");
+            return e_failure;
+        }
+        hdr->archive_entries = count;
+        hdr->toc_pos = cur.pos;
+        hdr->toc_size = toc_size;
+        cur.pos += lsb_carrier_bytes(toc_size, cur.depth) + (hdr->has_crc ? lsb_carrier_bytes(4, cur.depth) : 0);
+        hdr->extn[0] = '\0';
+    }
+    else
+    {
+        stats_phase(stats, "extn", bmp_carrier_end(cur.bmp, cur.pos), 0, cur.pos);
+        if (cursor_extract_length(&cur, &len) == e_failure || len >= sizeof(hdr->extn) ||
+            cursor_extract(&cur, (unsigned char *)hdr->extn, len) == e_failure)
+        {
+            steg_set_error("Invalid secret file extension");
+            return e_failure;
+        }
+        hdr->extn[len] = '\0';
+    }
+
+    // Every LZ block takes at least a block word and a byte, every stored byte at least two carrier bytes
+    stats_phase(stats, "data", bmp_carrier_end(cur.bmp, cur.pos), 0, cur.pos);
+    if (cursor_extract_size(&cur, &size) == e_failure || (size_t)size != size ||
+        (hdr->codec == CODEC_LZ
+             ? (size / LZ_BLOCK_SIZE + (size % LZ_BLOCK_SIZE != 0)) * (lsb_carrier_bytes(4, cur.depth) + 1) > cur.size - cur.pos
+             : size > cur.size - cur.pos || lsb_carrier_bytes(size, cur.depth) > cur.size - cur.pos))
+    {
+        steg_set_error("Invalid secret file length");
+        return e_failure;
+    }
+    hdr->secret_size = size;
+    hdr->data_pos = cur.pos;
+    if (hdr->shard.count > 0)
+    {
+        if (size > hdr->shard.total_size - hdr->shard.offset)
+        {
+            steg_set_error("Invalid shard");
+            return e_failure;
+        }
+        hdr->shard.size = size;
+    }
+    return e_success;
+}
+
+Status steg_extract(const unsigned char *image, size_t image_size, const StegHeader *hdr,
+                    const StegOptions *opts, unsigned char *out, StegStats *stats)
+{
+    StegCursor cur;
+
+    if (hdr->bmp.file_size != image_size)
+    {
+        steg_set_error("Header does not belong to this image");
+        return e_failure;
+    }
+    if (hdr->is_archive)
+    {
+        steg_set_error("Image holds an archive, extract its files with steg_extract_range");
+        return e_failure;
+    }
+    cur.dst = NULL;
+    cur.src = image;
+    cur.bmp = &hdr->bmp;
+    cur.pos = hdr->data_pos;
+    cur.size = hdr->bmp.carrier_size;
+    cur.num_threads = opts != NULL ? opts->num_threads : 1;
+    cur.depth = hdr->lsb_depth;
+    lsb_kernel_init();
+
+    if (cursor_extract_data(&cur, out, hdr->secret_size, hdr->codec, hdr->has_crc) == e_failure)
+    {
+        return e_failure;
+    }
+    stats_phase(stats, NULL, bmp_carrier_end(cur.bmp, cur.pos), hdr->secret_size, cur.pos);
+    return e_success;
+}
@@ -0,0 +1,163 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef LSB_STEG_H
+#define LSB_STEG_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "types.h" // Contains user defined types
+#include "common.h"
+#include "bmp.h"
+#include "stats.h"
+
+/*
+ * In-memory embed/extract API, built as liblsbsteg.a / liblsbsteg.so.
+ * Every image and secret is a pointer/length view owned by the caller and
+ * nothing is opened or printed. A function that fails returns e_failure
+ * and steg_last_error() (stats.h) says why. The stego layout is the same
+ * as the lsb_steg command line tool.
+ *
+ * opts may be NULL for 1 bit per byte, uncompressed, single threaded;
+ * stats may be NULL when per-phase numbers are not wanted.
+ */
+
+#define STEG_MAX_EXTN 16    // Longest secret file extension, including the dot and the NUL
+#define STEG_MAX_SHARDS 0xFFFF
+#define STEG_MAX_NAME 256   // Longest archive file name, including the NUL
+
+/* Which part of a secret split across several images one image holds */
+typedef struct _StegShard
+{
+    uint set_id;                // Same in every shard of one secret, the CRC32C of all of it
+    uint index;                 // 0 .. count - 1
+    uint count;                 // Shards in the set, 0 when the image holds a whole secret
+    size_t offset;              // Where the shard starts in the whole secret
+    size_t size;                // Bytes of the secret in this shard
+    size_t total_size;          // Bytes in the whole secret
+} StegShard;
+
+/* One file to put in an archive */
+typedef struct _StegFile
+{
+    const char *name;           // Name stored in the table of contents
+    const unsigned char *data;
+    size_t size;
+} StegFile;
+
+/* One table of contents entry of an archive */
+typedef struct _StegEntry
+{
+    char name[STEG_MAX_NAME];
+    size_t offset;              // Where the file starts in the archive data
+    size_t size;
+    uint crc;                   // CRC32C of the file
+} StegEntry;
+
+/* What steg_read_header found in a stego image */
+typedef struct _StegHeader
+{
+    BmpInfo bmp;                // Carrier layout the header was found in
+    int version;                // Header version, see common.h
+    int lsb_depth;              // LSB bits per carrier byte of the secret data
+    int codec;                  // CODEC_NONE or CODEC_LZ
+    int has_crc;                // steg_extract checks the data against its CRC32C
+    StegShard shard;            // shard.count is 0 unless the image holds one shard of a secret
+    int is_archive;             // A table of contents replaces the extension, see steg_read_toc
+    size_t archive_entries;     // Files in the archive
+    size_t toc_pos;             // Carrier position of the table of contents
+    size_t toc_size;            // Bytes in the table of contents
+    char extn[STEG_MAX_EXTN];   // Secret file extension with its dot, e.g. ".txt"
+    size_t secret_size;         // Bytes steg_extract writes, all the file data of an archive
+    size_t data_pos;            // Carrier position of the secret data
+} StegHeader;
+
+/*
+ * Hide secret in a copy of image. out must hold image_size bytes and must
+ * not overlap image; extn is the secret file extension with its dot.
+ */
+Status steg_embed(const unsigned char *image, size_t image_size,
+                  const unsigned char *secret, size_t secret_size,
+                  const char *extn, const char *magic, const StegOptions *opts,
+                  unsigned char *out, StegStats *stats);
+
+/*
+ * Like steg_embed, but only the stego image up to its last carrier byte
+ * written is put in out, and *prefix_size says how many bytes that is.
+ * The rest would be a copy of image. out must still have room for
+ * image_size bytes. Used to update a stego image in place: image is the
+ * current stego image and only the prefix bytes that differ need writing.
+ */
+Status steg_embed_prefix(const unsigned char *image, size_t image_size,
+                         const unsigned char *secret, size_t secret_size,
+                         const char *extn, const char *magic, const StegOptions *opts,
+                         unsigned char *out, size_t *prefix_size);
+
+/*
+ * Hide secret[shard->offset .. shard->offset + shard->size) as shard
+ * shard->index of shard->count; the set id and total size are taken from
+ * shard as given. steg_extract of the shard writes shard->size bytes.
+ */
+Status steg_embed_shard(const unsigned char *image, size_t image_size, const unsigned char *secret,
+                        const StegShard *shard, const char *extn, const char *magic,
+                        const StegOptions *opts, unsigned char *out, StegStats *stats);
+
+/*
+ * Most secret bytes an image with carrier_size carrier bytes (BmpInfo)
+ * can hold with these options and magic string and extension lengths,
+ * with room for a shard header when sharded is set. With compression the
+ * figure assumes no block shrinks. It only grows with carrier_size.
+ * Channel masks are not counted, the whole of every pixel is assumed.
+ */
+size_t steg_capacity(size_t carrier_size, size_t magic_len, size_t extn_len,
+                     const StegOptions *opts, int sharded);
+
+/* Check the magic string and read the header, so the caller can size the output */
+Status steg_read_header(const unsigned char *image, size_t image_size, const char *magic,
+                        StegHeader *hdr, StegStats *stats);
+
+/* Extract the secret described by hdr into out, which holds hdr->secret_size bytes */
+Status steg_extract(const unsigned char *image, size_t image_size, const StegHeader *hdr,
+                    const StegOptions *opts, unsigned char *out, StegStats *stats);
+
+/*
+ * Archives hold several files behind a table of contents placed right after
+ * the format word. Each file starts on a carrier byte, so any file or byte
+ * range is read straight from its position and costs time in proportion to
+ * its length only. Archives are stored uncompressed.
+ */
+Status steg_embed_archive(const unsigned char *image, size_t image_size, const StegFile *files, size_t nfiles,
+                          const char *magic, const StegOptions *opts, unsigned char *out, StegStats *stats);
+
+/* Read the hdr->archive_entries entries of the table of contents */
+Status steg_read_toc(const unsigned char *image, size_t image_size, const StegHeader *hdr, StegEntry *entries);
+
+/*
+ * Extract len bytes from offset on of one archive file into out. A whole
+ * file is checked against its CRC32C.
+ */
+Status steg_extract_range(const unsigned char *image, size_t image_size, const StegHeader *hdr,
+                          const StegEntry *entry, size_t offset, size_t len, const StegOptions *opts,
+                          unsigned char *out);
+
+/*
+ * Probing only tells whether an image carries the magic string. head is the
+ * start of a file_size byte image; steg_probe_size says how much of it is
+ * needed, given at least the first BMP_HEADER_SIZE bytes (0 if it is not a
+ * usable BMP). That is a few hundred bytes for most images.
+ */
+size_t steg_probe_size(const unsigned char *head, size_t file_size);
+Status steg_probe(const unsigned char *head, size_t head_size, size_t file_size, const char *magic);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
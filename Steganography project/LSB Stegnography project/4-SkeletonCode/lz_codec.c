@@ -0,0 +1,225 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "lz_codec.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+#define LZ_LAST_LITERALS 5  // The block always ends with a few literals
+#define LZ_MATCH_LIMIT 12   // No match starts this close to the end
+
+static uint32_t lz_hash(const unsigned char *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Write the 255-byte continuation of a length that did not fit in its nibble */
+static int put_length(unsigned char *dst, int op, int cap, int n)
+{
+    for (; n >= 255; n -= 255)
+    {
+        if (op >= cap)
+        {
+            return -1;
+        }
+        dst[op++] = 255;
+    }
+    if (op >= cap)
+    {
+        return -1;
+    }
+    dst[op++] = n;
+    return op;
+}
+
+/* Emit literals src[anchor..ip) and, when offset is not 0, a match of mlen bytes */
+static int put_sequence(const unsigned char *src, int anchor, int ip, int offset, int mlen,
+                        unsigned char *dst, int op, int cap)
+{
+    int lit = ip - anchor;
+    int token = op;
+
+    if (op >= cap)
+    {
+        return -1;
+    }
+    dst[op++] = (lit < 15 ? lit : 15) << 4;
+    if (lit >= 15 && (op = put_length(dst, op, cap, lit - 15)) < 0)
+    {
+        return -1;
+    }
+    if (lit > cap - op)
+    {
+        return -1;
+    }
+    memcpy(dst + op, src + anchor, lit);
+    op += lit;
+
+    if (offset == 0)
+    {
+        return op;  // Last sequence, literals only
+    }
+    if (cap - op < 2)
+    {
+        return -1;
+    }
+    dst[op++] = offset;
+    dst[op++] = offset >> 8;
+
+    mlen -= LZ_MIN_MATCH;
+    dst[token] |= mlen < 15 ? mlen : 15;
+    if (mlen >= 15)
+    {
+        op = put_length(dst, op, cap, mlen - 15);
+    }
+    return op;
+}
+
+/* Length of the match at ip against ref, compared 8 bytes at a time up to end */
+static int match_length(const unsigned char *src, int ref, int ip, int end)
+{
+    int mlen = LZ_MIN_MATCH;
+
+    while (ip + mlen + 8 <= end)
+    {
+        uint64_t a, b;
+        memcpy(&a, src + ref + mlen, 8);
+        memcpy(&b, src + ip + mlen, 8);
+        if (a != b)
+        {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+            return mlen + __builtin_clzll(a ^ b) / 8;  // First differing byte
+#else
+            return mlen + __builtin_ctzll(a ^ b) / 8;
+#endif
+        }
+        mlen += 8;
+    }
+    while (ip + mlen < end && src[ref + mlen] == src[ip + mlen])
+    {
+        mlen++;
+    }
+    return mlen;
+}
+
+int lz_compress_block(const unsigned char *src, int len, unsigned char *dst, int cap)
+{
+    int table[1 << LZ_HASH_BITS];
+    int ip = 0, anchor = 0, op = 0;
+
+    memset(table, 0, sizeof(table));
+
+    while (ip < len - LZ_MATCH_LIMIT)
+    {
+        uint32_t h = lz_hash(src + ip);
+        int ref = table[h];
+        table[h] = ip;
+
+        if (ref < ip && ip - ref <= LZ_MAX_OFFSET && memcmp(src + ref, src + ip, LZ_MIN_MATCH) == 0)
+        {
+            int mlen = match_length(src, ref, ip, len - LZ_LAST_LITERALS);
+            op = put_sequence(src, anchor, ip, ip - ref, mlen, dst, op, cap);
+            if (op < 0)
+            {
+                return -1;
+            }
+            ip += mlen;
+            anchor = ip;
+            if (ip < len - LZ_MATCH_LIMIT)
+            {
+                table[lz_hash(src + ip - 2)] = ip - 2;  // Cheap extra entry for the next search
+            }
+        }
+        else
+        {
+            ip += 1 + ((ip - anchor) >> 6);  // Step faster through data that does not compress
+        }
+    }
+
+    return put_sequence(src, anchor, len, 0, 0, dst, op, cap);
+}
+
+/* Read the continuation bytes of a length, or -1 past the end of the block */
+static int get_length(const unsigned char *src, int len, int *ip, int n)
+{
+    int b;
+
+    do
+    {
+        if (*ip >= len)
+        {
+            return -1;
+        }
+        b = src[(*ip)++];
+        n += b;
+    } while (b == 255);
+    return n;
+}
+
+int lz_decompress_block(const unsigned char *src, int len, unsigned char *dst, int cap)
+{
+    int ip = 0, op = 0;
+
+    while (ip < len)
+    {
+        int token = src[ip++];
+        int lit = token >> 4;
+        int mlen = token & 15;
+        int offset;
+
+        if (lit == 15 && (lit = get_length(src, len, &ip, lit)) < 0)
+        {
+            return -1;
+        }
+        if (lit > len - ip || lit > cap - op)
+        {
+            return -1;
+        }
+        memcpy(dst + op, src + ip, lit);
+        ip += lit;
+        op += lit;
+
+        if (ip == len)
+        {
+            break;  // Last sequence
+        }
+        if (len - ip < 2)
+        {
+            return -1;
+        }
+        offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        if (mlen == 15 && (mlen = get_length(src, len, &ip, mlen)) < 0)
+        {
+            return -1;
+        }
+        mlen += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || mlen > cap - op)
+        {
+            return -1;
+        }
+
+        if (offset >= mlen)
+        {
+            memcpy(dst + op, dst + op - offset, mlen);
+            op += mlen;
+        }
+        else
+        {
+            // Byte by byte, the match overlaps the bytes it produces
+            for (const unsigned char *ref = dst + op - offset; mlen > 0; mlen--)
+            {
+                dst[op++] = *ref++;
+            }
+        }
+    }
+    return op;
+}
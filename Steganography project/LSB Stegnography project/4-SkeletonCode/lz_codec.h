@@ -0,0 +1,34 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include "types.h" // Contains user defined types
+#include "common.h"
+
+/*
+ * Small LZ77 block codec for the secret data. Each block is a run of
+ * sequences: a token byte (literal count in the high nibble, match
+ * length - 4 in the low nibble, 15 meaning more length bytes follow),
+ * the literals, a 2 byte little-endian match offset and the extra match
+ * length bytes. The last sequence of a block has literals only.
+ *
+ * In the stego image each block is preceded by a block word: the stored
+ * size in bits 0-30 and LZ_BLOCK_RAW when the block did not compress and
+ * is stored as is.
+ */
+
+#define LZ_BLOCK_SIZE MAX_SECRET_BUF_SIZE   // Uncompressed bytes per block
+#define LZ_BLOCK_RAW 0x80000000u
+
+/* Compress len bytes of src into dst; returns the size, or -1 if it does not fit in cap bytes */
+int lz_compress_block(const unsigned char *src, int len, unsigned char *dst, int cap);
+
+/* Decompress a block into dst; returns the size, or -1 if the block is corrupt or larger than cap */
+int lz_decompress_block(const unsigned char *src, int len, unsigned char *dst, int cap);
+
+#endif
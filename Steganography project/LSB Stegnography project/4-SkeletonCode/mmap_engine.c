@@ -0,0 +1,242 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "mmap_engine.h"
+#include "types.h"
+#include "common.h"
+#include "lsb_steg.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+void *map_file(int fd, size_t size, int prot)
+{
+    void *addr;
+
+    if (size == 0)
+    {
+        return NULL;
+    }
+    addr = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+    {
+        perror("mmap");
+        return MAP_FAILED;
+    }
+    madvise(addr, size, MADV_SEQUENTIAL);  // Every stage walks the file front to back
+    return addr;
+}
+
+void *map_output_fd(int fd, size_t size)
+{
+    if (ftruncate(fd, size) != 0)
+    {
+        perror("ftruncate");
+        return MAP_FAILED;
+    }
+    return map_file(fd, size, PROT_READ | PROT_WRITE);
+}
+
+/* Create fname with the given size and map it for writing */
+static void *create_mapped_file(const char *fname, size_t size)
+{
+    void *addr;
+    int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        return MAP_FAILED;
+    }
+    addr = map_output_fd(fd, size);
+    close(fd);  // The mapping keeps the file referenced
+    return addr;
+}
+
+Status do_encoding_mmap(EncodeInfo *encInfo)
+{
+    struct stat src_st, secret_st;
+    unsigned char *src, *dst;
+    const unsigned char *secret;
+    const char *extn;
+    StegStats local_stats;
+    StegStats *stats = encInfo->stats;
+    Status ret;
+
+    if (fstat(fileno(encInfo->fptr_src_image), &src_st) != 0 ||
+        fstat(fileno(encInfo->fptr_secret), &secret_st) != 0)
+    {
+        perror("fstat");
+        return e_failure;
+    }
+    if ((size_t)src_st.st_size < BMP_HEADER_SIZE)
+    {
+        fprintf(stderr, "ERROR: %s is not a BMP image\n", encInfo->src_image_fname);
+        return e_failure;
+    }
+
+    LOG_INFO("INFO: Mapping source image, secret file and stego image.\n");
+    src = map_file(fileno(encInfo->fptr_src_image), src_st.st_size, PROT_READ);
+    if (src == MAP_FAILED)
+    {
+        return e_failure;
+    }
+    secret = map_file(fileno(encInfo->fptr_secret), secret_st.st_size, PROT_READ);
+    if (secret == MAP_FAILED)
+    {
+        munmap(src, src_st.st_size);
+        return e_failure;
+    }
+    dst = create_mapped_file(encInfo->stego_image_fname, src_st.st_size);
+    if (dst == MAP_FAILED)
+    {
+        ret = e_failure;
+        goto unmap_secret;
+    }
+
+    extn = secret_file_extn(encInfo->secret_fname);  // Extension starts at the dot
+    if (stats == NULL)
+    {
+        stats_init(&local_stats, "encode", "mmap");  // Still needed for the compressed size
+        stats = &local_stats;
+    }
+
+    // The mappings are plain buffers to the in-memory API
+    ret = steg_embed(src, src_st.st_size, secret, secret_st.st_size, extn, encInfo->magic_string,
+                     encInfo->opts, dst, stats);
+    if (ret == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+    }
+    else
+    {
+        if (stats->compressed >= 0)
+        {
+            LOG_INFO("INFO: Compressed %lld bytes of secret data to %lld bytes\n",
+                     (long long)secret_st.st_size, stats->compressed);
+        }
+        LOG_INFO("INFO: Secret file data encoded successfully.\n");
+        LOG_INFO("INFO: Remaining image data copied successfully.\n");
+    }
+
+    munmap(dst, src_st.st_size);
+unmap_secret:
+    if (secret != NULL)
+    {
+        munmap((void *)secret, secret_st.st_size);
+    }
+    munmap(src, src_st.st_size);
+    return ret;
+}
+
+Status do_decoding_mmap(DecodeInfo *decInfo)
+{
+    struct stat st;
+    unsigned char *src, *dst;
+    StegHeader hdr;
+    Status ret = e_failure;
+    int fd = open(decInfo->stego_image_fname, O_RDONLY);
+
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", decInfo->stego_image_fname);
+        return e_failure;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < BMP_HEADER_SIZE)
+    {
+        fprintf(stderr, "ERROR: %s is not a BMP image\n", decInfo->stego_image_fname);
+        close(fd);
+        return e_failure;
+    }
+    src = map_file(fd, st.st_size, PROT_READ);
+    close(fd);
+    if (src == MAP_FAILED)
+    {
+        return e_failure;
+    }
+
+    if (steg_read_header(src, st.st_size, decInfo->magic_string, &hdr, decInfo->stats) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto unmap_src;
+    }
+    if (hdr.is_archive)
+    {
+        fprintf(stderr, "ERROR: %s holds an archive, list it with -l or extract a file with -x <name>\n",
+                decInfo->stego_image_fname);
+        goto unmap_src;
+    }
+    if (hdr.shard.count > 0)
+    {
+        fprintf(stderr, "ERROR: %s holds one shard of a split secret, decode every shard with -D\n",
+                decInfo->stego_image_fname);
+        goto unmap_src;
+    }
+    LOG_INFO("INFO: Magic String decoded successfully\n");
+    decInfo->bmp = hdr.bmp;
+    decInfo->header_version = hdr.version;
+    decInfo->lsb_depth = hdr.lsb_depth;
+    decInfo->codec = hdr.codec;
+    decInfo->has_crc = hdr.has_crc;
+    decInfo->size_secret_file = hdr.secret_size;
+
+    // Append the decoded extension to the output name
+    if (strlen(hdr.extn) >= sizeof(decInfo->secret_fname) - strlen(decInfo->secret_fname))
+    {
+        fprintf(stderr, "ERROR: Invalid secret file extension\n");
+        goto unmap_src;
+    }
+    strcat(decInfo->secret_fname, hdr.extn);
+    LOG_INFO("INFO: Output File Extension decoded successfully\n");
+
+    // Extract the secret data straight into the mapped output file
+    dst = create_mapped_file(decInfo->secret_fname, hdr.secret_size);
+    if (dst == MAP_FAILED)
+    {
+        goto unmap_src;
+    }
+    ret = steg_extract(src, st.st_size, &hdr, decInfo->opts, dst, decInfo->stats);
+    if (dst != NULL)
+    {
+        munmap(dst, hdr.secret_size);
+    }
+    if (ret == e_success)
+    {
+        LOG_INFO("INFO: Data decoded successfully and copied to file\n");
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+    }
+
+unmap_src:
+    munmap(src, st.st_size);
+    return ret;
+}
+
+#else
+
+Status do_encoding_mmap(EncodeInfo *encInfo)
+{
+    fprintf(stderr, "ERROR: The mmap engine is not supported on this platform\n");
+    return e_failure;
+}
+
+Status do_decoding_mmap(DecodeInfo *decInfo)
+{
+    fprintf(stderr, "ERROR: The mmap engine is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef MMAP_ENGINE_H
+#define MMAP_ENGINE_H
+
+#include "types.h" // Contains user defined types
+#include "encode.h"
+#include "decode.h"
+
+/*
+ * Alternative engine that maps the source image, secret and output
+ * files and runs the LSB kernels directly over the mapped pixel array.
+ * The stego image layout is the same as do_encoding/do_decoding.
+ * With opts->num_threads > 1 the secret data region is split into
+ * slabs that are embedded/extracted on a thread pool.
+ */
+
+/* Encode using the files already opened by open_files */
+Status do_encoding_mmap(EncodeInfo *encInfo);
+
+/* Decode stego_image_fname into secret_fname + decoded extension */
+Status do_decoding_mmap(DecodeInfo *decInfo);
+
+#ifndef _WIN32
+/* Map a whole file, NULL for an empty one and MAP_FAILED on error */
+void *map_file(int fd, size_t size, int prot);
+
+/* Resize an output file opened for read/write and map it for writing */
+void *map_output_fd(int fd, size_t size);
+#endif
+
+#endif
@@ -0,0 +1,72 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "parallel.h"
+#include "stats.h"
+
+typedef struct _ParallelJobs
+{
+    parallel_fn fn;
+    void *arg;
+    size_t njobs;
+    size_t next;    // Next job to hand out, updated atomically
+} ParallelJobs;
+
+static void *parallel_worker(void *data)
+{
+    ParallelJobs *jobs = data;
+    size_t job;
+
+    while ((job = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED)) < jobs->njobs)
+    {
+        jobs->fn(job, jobs->arg);
+    }
+    return NULL;
+}
+
+Status run_parallel(int nthreads, size_t njobs, parallel_fn fn, void *arg)
+{
+    ParallelJobs jobs = { fn, arg, njobs, 0 };
+    pthread_t *threads;
+    int started = 0;
+
+    if (nthreads > (long)njobs)
+    {
+        nthreads = njobs;
+    }
+    if (nthreads <= 1)
+    {
+        parallel_worker(&jobs);
+        return e_success;
+    }
+
+    threads = malloc((nthreads - 1) * sizeof(*threads));
+    if (threads == NULL)
+    {
+        steg_set_error("Out of memory");
+        return e_failure;
+    }
+    for (int i = 0; i < nthreads - 1; i++)
+    {
+        if (pthread_create(&threads[i], NULL, parallel_worker, &jobs) != 0)
+        {
+            break;  // Run with the threads we have
+        }
+        started++;
+    }
+
+    parallel_worker(&jobs);
+
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    return e_success;
+}
@@ -0,0 +1,23 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/* One unit of work; job is in 0 .. njobs - 1 */
+typedef void (*parallel_fn)(size_t job, void *arg);
+
+/*
+ * Run fn for every job on up to nthreads threads (the caller is one of them).
+ * Jobs are handed out in increasing order from a shared counter, so
+ * threads that finish early keep picking up the remaining work.
+ */
+Status run_parallel(int nthreads, size_t njobs, parallel_fn fn, void *arg);
+
+#endif
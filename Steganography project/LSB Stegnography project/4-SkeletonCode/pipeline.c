@@ -0,0 +1,353 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pipeline.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+/* Blocks per ring and their size; 4 MB read ahead is enough to hide a slow disk */
+#define PIPE_BLOCKS 4
+#define PIPE_BLOCK_SIZE (1024 * 1024)
+
+/* Page aligned, so the blocks also suit O_DIRECT */
+#define PIPE_ALIGN 4096
+
+/*
+ * One ring of blocks between the caller and an I/O thread. The thread
+ * works on block head and the caller on block tail; a block is full when
+ * it holds data for the side that did not fill it.
+ */
+typedef struct _Ring
+{
+    unsigned char *blocks[PIPE_BLOCKS];
+    size_t len[PIPE_BLOCKS];    // Bytes in a full block
+    int full[PIPE_BLOCKS];
+    size_t head;                // Block the thread works on next
+    size_t tail;                // Block the caller works on
+    size_t used;                // Bytes of the tail block the caller read or filled
+    int fd;
+    size_t offset;              // File offset of the head block
+    int stop;                   // Set by pipeline_close
+    int error;                  // errno of a failed read or write
+    pthread_t thread;
+    int started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // Signalled whenever a block changes hands
+} Ring;
+
+struct _Pipeline
+{
+    Ring in;
+    Ring out;
+    int has_out;                // Output ring in use, not when decoding
+};
+
+static void *reader_thread(void *data)
+{
+    Ring *ring = data;
+
+    for (;;)
+    {
+        unsigned char *block;
+        ssize_t n;
+
+        pthread_mutex_lock(&ring->lock);
+        while (ring->full[ring->head] && !ring->stop)
+        {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        if (ring->stop)
+        {
+            pthread_mutex_unlock(&ring->lock);
+            break;
+        }
+        block = ring->blocks[ring->head];
+        pthread_mutex_unlock(&ring->lock);
+
+        do
+        {
+            n = pread(ring->fd, block, PIPE_BLOCK_SIZE, ring->offset);
+        } while (n < 0 && errno == EINTR);
+
+        // A short block is fine, an empty one marks the end of the file
+        pthread_mutex_lock(&ring->lock);
+        ring->error = n < 0 ? errno : 0;
+        ring->len[ring->head] = n > 0 ? n : 0;
+        ring->full[ring->head] = 1;
+        ring->head = (ring->head + 1) % PIPE_BLOCKS;
+        pthread_cond_broadcast(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+        if (n <= 0)
+        {
+            break;
+        }
+        ring->offset += n;
+    }
+    return NULL;
+}
+
+static void *writer_thread(void *data)
+{
+    Ring *ring = data;
+
+    for (;;)
+    {
+        unsigned char *block;
+        size_t len, done = 0;
+
+        pthread_mutex_lock(&ring->lock);
+        while (!ring->full[ring->head] && !ring->stop)
+        {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        if (!ring->full[ring->head])
+        {
+            pthread_mutex_unlock(&ring->lock);
+            break;  // Stopped with every block written
+        }
+        block = ring->blocks[ring->head];
+        len = ring->len[ring->head];
+        pthread_mutex_unlock(&ring->lock);
+
+        while (done < len && ring->error == 0)
+        {
+            ssize_t n = pwrite(ring->fd, block + done, len - done, ring->offset + done);
+            if (n > 0)
+            {
+                done += n;
+            }
+            else if (n == 0 || errno != EINTR)
+            {
+                ring->error = n < 0 ? errno : EIO;
+            }
+        }
+        ring->offset += len;
+
+        pthread_mutex_lock(&ring->lock);
+        ring->full[ring->head] = 0;
+        ring->head = (ring->head + 1) % PIPE_BLOCKS;
+        pthread_cond_broadcast(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+    }
+    return NULL;
+}
+
+static Status ring_init(Ring *ring, int fd, size_t offset, void *(*fn)(void *))
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = fd;
+    ring->offset = offset;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->cond, NULL);
+    for (int i = 0; i < PIPE_BLOCKS; i++)
+    {
+        if (posix_memalign((void **)&ring->blocks[i], PIPE_ALIGN, PIPE_BLOCK_SIZE) != 0)
+        {
+            return e_failure;
+        }
+    }
+    if (pthread_create(&ring->thread, NULL, fn, ring) != 0)
+    {
+        return e_failure;
+    }
+    ring->started = 1;
+    return e_success;
+}
+
+/* Stop the thread once it is idle, the writer only after the last full block */
+static void ring_stop(Ring *ring)
+{
+    if (ring->started)
+    {
+        pthread_mutex_lock(&ring->lock);
+        ring->stop = 1;
+        pthread_cond_broadcast(&ring->cond);
+        pthread_mutex_unlock(&ring->lock);
+        pthread_join(ring->thread, NULL);
+        ring->started = 0;
+    }
+}
+
+static void ring_free(Ring *ring)
+{
+    for (int i = 0; i < PIPE_BLOCKS; i++)
+    {
+        free(ring->blocks[i]);
+    }
+    pthread_mutex_destroy(&ring->lock);
+    pthread_cond_destroy(&ring->cond);
+}
+
+Pipeline *pipeline_open(int fd_src, int fd_dest, size_t offset)
+{
+    Pipeline *pl = calloc(1, sizeof(Pipeline));
+
+    if (pl == NULL)
+    {
+        return NULL;
+    }
+    pl->has_out = fd_dest >= 0;
+    if (ring_init(&pl->in, fd_src, offset, reader_thread) == e_failure ||
+        (pl->has_out && ring_init(&pl->out, fd_dest, offset, writer_thread) == e_failure))
+    {
+        ring_stop(&pl->in);
+        ring_free(&pl->in);
+        if (pl->has_out)
+        {
+            ring_stop(&pl->out);
+            ring_free(&pl->out);
+        }
+        free(pl);
+        return NULL;
+    }
+    return pl;
+}
+
+Status pipeline_read(Pipeline *pl, unsigned char *buf, size_t n)
+{
+    Ring *ring = &pl->in;
+
+    while (n > 0)
+    {
+        size_t take;
+
+        // Only the caller empties a block, so it stays full once seen full
+        pthread_mutex_lock(&ring->lock);
+        while (!ring->full[ring->tail])
+        {
+            pthread_cond_wait(&ring->cond, &ring->lock);
+        }
+        pthread_mutex_unlock(&ring->lock);
+        if (ring->len[ring->tail] == 0)
+        {
+            if (ring->error != 0)
+            {
+                fprintf(stderr, "ERROR: Unable to read the image: %s\n", strerror(ring->error));
+            }
+            return e_failure;  // End of the file
+        }
+
+        take = ring->len[ring->tail] - ring->used < n ? ring->len[ring->tail] - ring->used : n;
+        memcpy(buf, ring->blocks[ring->tail] + ring->used, take);
+        ring->used += take;
+        buf += take;
+        n -= take;
+        if (ring->used == ring->len[ring->tail])
+        {
+            pthread_mutex_lock(&ring->lock);
+            ring->full[ring->tail] = 0;
+            ring->tail = (ring->tail + 1) % PIPE_BLOCKS;
+            ring->used = 0;
+            pthread_cond_broadcast(&ring->cond);
+            pthread_mutex_unlock(&ring->lock);
+        }
+    }
+    return e_success;
+}
+
+/* Hand the tail block to the writer */
+static void submit_block(Ring *ring)
+{
+    pthread_mutex_lock(&ring->lock);
+    ring->len[ring->tail] = ring->used;
+    ring->full[ring->tail] = 1;
+    ring->tail = (ring->tail + 1) % PIPE_BLOCKS;
+    ring->used = 0;
+    pthread_cond_broadcast(&ring->cond);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+Status pipeline_write(Pipeline *pl, const unsigned char *buf, size_t n)
+{
+    Ring *ring = &pl->out;
+
+    while (n > 0)
+    {
+        size_t take;
+
+        if (ring->used == 0)
+        {
+            // Wait for the writer to be done with the block
+            pthread_mutex_lock(&ring->lock);
+            while (ring->full[ring->tail])
+            {
+                pthread_cond_wait(&ring->cond, &ring->lock);
+            }
+            pthread_mutex_unlock(&ring->lock);
+            if (ring->error != 0)
+            {
+                fprintf(stderr, "ERROR: Unable to write the image: %s\n", strerror(ring->error));
+                return e_failure;
+            }
+        }
+
+        take = PIPE_BLOCK_SIZE - ring->used < n ? PIPE_BLOCK_SIZE - ring->used : n;
+        memcpy(ring->blocks[ring->tail] + ring->used, buf, take);
+        ring->used += take;
+        buf += take;
+        n -= take;
+        if (ring->used == PIPE_BLOCK_SIZE)
+        {
+            submit_block(ring);
+        }
+    }
+    return e_success;
+}
+
+Status pipeline_close(Pipeline *pl)
+{
+    Status ret = e_success;
+
+    ring_stop(&pl->in);
+    ring_free(&pl->in);
+    if (pl->has_out)
+    {
+        if (pl->out.used > 0)
+        {
+            submit_block(&pl->out);  // The last, partly filled block
+        }
+        ring_stop(&pl->out);
+        if (pl->out.error != 0)
+        {
+            fprintf(stderr, "ERROR: Unable to write the image: %s\n", strerror(pl->out.error));
+            ret = e_failure;
+        }
+        ring_free(&pl->out);
+    }
+    free(pl);
+    return ret;
+}
+
+#else
+
+Pipeline *pipeline_open(int fd_src, int fd_dest, size_t offset)
+{
+    return NULL;  // The stdio streams are used as they are
+}
+
+Status pipeline_read(Pipeline *pl, unsigned char *buf, size_t n)
+{
+    return e_failure;
+}
+
+Status pipeline_write(Pipeline *pl, const unsigned char *buf, size_t n)
+{
+    return e_failure;
+}
+
+Status pipeline_close(Pipeline *pl)
+{
+    return e_success;
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stddef.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * Overlapped image I/O for the stdio engine (--pipeline). A reader thread
+ * reads the source image ahead into a ring of aligned blocks, and a writer
+ * thread writes the output from a second ring, so the disk is busy while
+ * the caller runs the LSB kernels on the block in between. Both threads
+ * use pread/pwrite at their own offsets, so the files must be regular
+ * files and the FILE streams over them are not used meanwhile.
+ */
+
+typedef struct _Pipeline Pipeline;
+
+/* Start reading fd_src and writing fd_dest (-1 when decoding) at offset; NULL on failure */
+Pipeline *pipeline_open(int fd_src, int fd_dest, size_t offset);
+
+/* Next n bytes of the source */
+Status pipeline_read(Pipeline *pl, unsigned char *buf, size_t n);
+
+/* Next n bytes of the output */
+Status pipeline_write(Pipeline *pl, const unsigned char *buf, size_t n);
+
+/* Write out what is left, stop both threads and free the pipeline */
+Status pipeline_close(Pipeline *pl);
+
+#endif
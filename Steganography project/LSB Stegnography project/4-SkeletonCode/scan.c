@@ -0,0 +1,290 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "scan.h"
+#include "common.h"
+#include "lsb_steg.h"
+#include "lsb_kernel.h"
+#include "parallel.h"
+
+/* Probing waits on the disk, so run more workers than CPUs */
+#define SCAN_WORKERS_PER_CPU 4
+
+/* Directory entries handed to the other workers at a time */
+#define SCAN_BATCH 256
+
+/* Enough for the probe region of almost every image */
+#define PROBE_BUF_SIZE 4096
+
+typedef struct _ScanItem
+{
+    char *path;
+    int is_dir;
+} ScanItem;
+
+typedef struct _Scan
+{
+    pthread_mutex_t lock;
+    pthread_cond_t more;        // Signalled when items are pushed or the scan ends
+    ScanItem *items;            // Stack of work shared by every worker
+    size_t nitems;
+    size_t cap;
+    int busy;                   // Workers holding an item, which may push more
+    const char *magic;
+    size_t nfiles;              // Files probed
+    size_t nmatches;
+} Scan;
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void push_items(Scan *scan, ScanItem *items, size_t n)
+{
+    pthread_mutex_lock(&scan->lock);
+    if (scan->nitems + n > scan->cap)
+    {
+        size_t cap = (scan->nitems + n) * 2;
+        ScanItem *grown = realloc(scan->items, cap * sizeof(*grown));
+        if (grown == NULL)
+        {
+            pthread_mutex_unlock(&scan->lock);
+            fprintf(stderr, "ERROR: Out of memory, skipping %zu paths\n", n);
+            for (size_t i = 0; i < n; i++)
+            {
+                free(items[i].path);
+            }
+            return;
+        }
+        scan->items = grown;
+        scan->cap = cap;
+    }
+    memcpy(scan->items + scan->nitems, items, n * sizeof(*items));
+    scan->nitems += n;
+    pthread_cond_broadcast(&scan->more);
+    pthread_mutex_unlock(&scan->lock);
+}
+
+/* Take the most recent item; 0 once the stack is empty and no worker can push more */
+static int pop_item(Scan *scan, ScanItem *item)
+{
+    pthread_mutex_lock(&scan->lock);
+    while (scan->nitems == 0 && scan->busy > 0)
+    {
+        pthread_cond_wait(&scan->more, &scan->lock);
+    }
+    if (scan->nitems == 0)
+    {
+        pthread_mutex_unlock(&scan->lock);
+        return 0;
+    }
+    *item = scan->items[--scan->nitems];
+    scan->busy++;
+    pthread_mutex_unlock(&scan->lock);
+    return 1;
+}
+
+static void finish_item(Scan *scan, ScanItem *item)
+{
+    free(item->path);
+    pthread_mutex_lock(&scan->lock);
+    if (--scan->busy == 0 && scan->nitems == 0)
+    {
+        pthread_cond_broadcast(&scan->more);  // Wake the idle workers so they can exit
+    }
+    pthread_mutex_unlock(&scan->lock);
+}
+
+static int is_bmp_name(const char *name)
+{
+    size_t len = strlen(name);
+    return len > 4 && strcasecmp(name + len - 4, ".bmp") == 0;
+}
+
+/* Queue the subdirectories and .bmp files of one directory; symlinks to directories are not followed */
+static void list_dir(Scan *scan, const char *path)
+{
+    ScanItem batch[SCAN_BATCH];
+    size_t n = 0;
+    struct dirent *ent;
+    DIR *dir = opendir(path);
+
+    if (dir == NULL)
+    {
+        fprintf(stderr, "ERROR: Unable to open directory %s\n", path);
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL)
+    {
+        int is_dir = ent->d_type == DT_DIR;
+        char *child;
+
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0 ||
+            (!is_dir && ent->d_type != DT_UNKNOWN && !is_bmp_name(ent->d_name)))
+        {
+            continue;
+        }
+        child = malloc(strlen(path) + strlen(ent->d_name) + 2);
+        if (child == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            break;
+        }
+        sprintf(child, "%s/%s", path, ent->d_name);
+
+        if (ent->d_type == DT_UNKNOWN)
+        {
+            // Some file systems do not fill in d_type
+            struct stat st;
+            if (lstat(child, &st) != 0 || !(S_ISDIR(st.st_mode) || is_bmp_name(ent->d_name)))
+            {
+                free(child);
+                continue;
+            }
+            is_dir = S_ISDIR(st.st_mode);
+        }
+
+        batch[n].path = child;
+        batch[n].is_dir = is_dir;
+        if (++n == SCAN_BATCH)
+        {
+            push_items(scan, batch, n);
+            n = 0;
+        }
+    }
+    closedir(dir);
+    if (n > 0)
+    {
+        push_items(scan, batch, n);
+    }
+}
+
+/* Read just enough of the file for steg_probe */
+static void probe_file(Scan *scan, const char *path)
+{
+    unsigned char buf[PROBE_BUF_SIZE];
+    unsigned char *head = buf;
+    struct stat st;
+    size_t need;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        return;
+    }
+    __atomic_fetch_add(&scan->nfiles, 1, __ATOMIC_RELAXED);
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= BMP_HEADER_SIZE &&
+        pread(fd, buf, BMP_HEADER_SIZE, 0) == BMP_HEADER_SIZE &&
+        (need = steg_probe_size(buf, st.st_size)) != 0)
+    {
+        if (need > sizeof(buf) && (head = malloc(need)) != NULL)
+        {
+            memcpy(head, buf, BMP_HEADER_SIZE);
+        }
+        need -= BMP_HEADER_SIZE;  // The header is already in head
+        if (head != NULL && pread(fd, head + BMP_HEADER_SIZE, need, BMP_HEADER_SIZE) == (ssize_t)need &&
+            steg_probe(head, need + BMP_HEADER_SIZE, st.st_size, scan->magic) == e_success)
+        {
+            __atomic_fetch_add(&scan->nmatches, 1, __ATOMIC_RELAXED);
+            printf("%s\n", path);  // One locked call, so lines from different workers never interleave
+        }
+        if (head != buf)
+        {
+            free(head);
+        }
+    }
+    close(fd);
+}
+
+static void scan_worker(size_t job, void *arg)
+{
+    Scan *scan = arg;
+    ScanItem item;
+    (void)job;
+
+    while (pop_item(scan, &item))
+    {
+        if (item.is_dir)
+        {
+            list_dir(scan, item.path);
+        }
+        else
+        {
+            probe_file(scan, item.path);
+        }
+        finish_item(scan, &item);
+    }
+}
+
+Status do_scan(char *paths[], int npaths, const char *magic, const StegOptions *opts)
+{
+    Scan scan;
+    int nworkers = opts->num_threads;
+    double start;
+    Status ret;
+
+    memset(&scan, 0, sizeof(scan));
+    pthread_mutex_init(&scan.lock, NULL);
+    pthread_cond_init(&scan.more, NULL);
+    scan.magic = magic;
+
+    for (int i = 0; i < npaths; i++)
+    {
+        struct stat st;
+        ScanItem item;
+
+        if (stat(paths[i], &st) != 0 || (item.path = strdup(paths[i])) == NULL)
+        {
+            fprintf(stderr, "ERROR: Unable to open %s\n", paths[i]);
+            continue;
+        }
+        item.is_dir = S_ISDIR(st.st_mode);
+        push_items(&scan, &item, 1);
+    }
+
+    if (nworkers < 1)
+    {
+        nworkers = sysconf(_SC_NPROCESSORS_ONLN) * SCAN_WORKERS_PER_CPU;
+    }
+    lsb_kernel_init();  // Pick the kernel before any worker thread uses it
+
+    start = get_time_sec();
+    ret = run_parallel(nworkers, nworkers, scan_worker, &scan);
+    fflush(stdout);
+    if (ret == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        for (size_t i = 0; i < scan.nitems; i++)
+        {
+            free(scan.items[i].path);
+        }
+    }
+    else if (steg_verbose)
+    {
+        // The match list owns stdout
+        fprintf(stderr, "INFO: Probed %zu files, %zu carry the magic string, in %.3f s\n",
+                scan.nfiles, scan.nmatches, get_time_sec() - start);
+    }
+
+    free(scan.items);
+    pthread_mutex_destroy(&scan.lock);
+    pthread_cond_destroy(&scan.more);
+    return ret;
+}
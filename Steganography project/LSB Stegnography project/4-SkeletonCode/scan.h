@@ -0,0 +1,25 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Probe mode: print every image under the given paths that carries the
+ * magic string, one path per line. Directories are walked recursively and
+ * files ending in .bmp are probed; paths named on the command line are
+ * probed whatever their name. Only the BMP header and the first few hundred
+ * bytes of pixel data of each file are read.
+ *
+ * Directories and files are work items on a shared stack that every worker
+ * takes from, so a worker that runs out of work picks up whatever the
+ * others have found, however the tree is shaped.
+ */
+Status do_scan(char *paths[], int npaths, const char *magic, const StegOptions *opts);
+
+#endif
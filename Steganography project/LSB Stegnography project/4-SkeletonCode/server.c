@@ -0,0 +1,382 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "server.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "lsb_steg.h"
+#include "lsb_kernel.h"
+#include "mmap_engine.h"
+#include "parallel.h"
+
+typedef struct _Server
+{
+    int listen_fd;
+    int num_workers;
+} Server;
+
+/* A read-only mapping of one of the request's descriptors */
+typedef struct _MappedFd
+{
+    unsigned char *addr;
+    size_t size;
+} MappedFd;
+
+/*
+ * The mappings belong to files the client still holds, and a client that
+ * truncates one mid-request turns the next access into SIGBUS. While a
+ * request runs the library on them, its worker points this at a jump
+ * buffer and the fault fails only that request.
+ */
+static _Thread_local sigjmp_buf *fault_jmp;
+
+static void on_sigbus(int sig)
+{
+    if (fault_jmp != NULL)
+    {
+        siglongjmp(*fault_jmp, 1);
+    }
+    signal(sig, SIG_DFL);  // Not a client file, crash as usual
+    raise(sig);
+}
+
+static void reply_error(ServerReply *reply, const char *msg)
+{
+    reply->status = e_failure;
+    snprintf(reply->error, sizeof(reply->error), "%s", msg);
+}
+
+/* Map a regular, non-empty input file; what names it in the reply on failure */
+static Status map_input(int fd, MappedFd *map, const char *what, int may_be_empty, ServerReply *reply)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        snprintf(reply->error, sizeof(reply->error), "The %s is not a regular file", what);
+        reply->status = e_failure;
+        return e_failure;
+    }
+    if (st.st_size == 0 && !may_be_empty)
+    {
+        snprintf(reply->error, sizeof(reply->error), "The %s is empty", what);
+        reply->status = e_failure;
+        return e_failure;
+    }
+    map->size = st.st_size;
+    map->addr = map_file(fd, map->size, PROT_READ);  // NULL for an empty file
+    if (map->addr == MAP_FAILED)
+    {
+        snprintf(reply->error, sizeof(reply->error), "Unable to map the %s", what);
+        reply->status = e_failure;
+        return e_failure;
+    }
+    return e_success;
+}
+
+static void unmap_input(MappedFd *map)
+{
+    if (map->addr != NULL && map->addr != MAP_FAILED)
+    {
+        munmap(map->addr, map->size);
+    }
+}
+
+static void serve_encode(const ServerRequest *req, const int *fds, ServerReply *reply)
+{
+    StegOptions opts = { .num_threads = 1, .lsb_depth = req->lsb_depth > 0 ? req->lsb_depth : 1,
+                         .compress = req->compress != 0 };
+    MappedFd image = { NULL, 0 }, secret = { NULL, 0 };
+    unsigned char *out;
+    sigjmp_buf jmp;
+
+    if (map_input(fds[0], &image, "image", 0, reply) == e_failure ||
+        map_input(fds[1], &secret, "secret", 1, reply) == e_failure)
+    {
+        goto unmap;
+    }
+    out = map_output_fd(fds[2], image.size);
+    if (out == MAP_FAILED)
+    {
+        reply_error(reply, "Unable to map the output file");
+        goto unmap;
+    }
+    if (sigsetjmp(jmp, 1) != 0)
+    {
+        fault_jmp = NULL;
+        reply_error(reply, "A file was truncated during the request");
+    }
+    else
+    {
+        fault_jmp = &jmp;
+        if (steg_embed(image.addr, image.size, secret.addr, secret.size, req->extn, req->magic, &opts,
+                       out, NULL) == e_failure)
+        {
+            reply_error(reply, steg_last_error());
+        }
+        else
+        {
+            reply->size = image.size;
+        }
+        fault_jmp = NULL;
+    }
+    munmap(out, image.size);
+unmap:
+    unmap_input(&image);
+    unmap_input(&secret);
+}
+
+static void serve_decode(const ServerRequest *req, const int *fds, ServerReply *reply)
+{
+    StegOptions opts = { .num_threads = 1, .lsb_depth = 1 };
+    MappedFd image = { NULL, 0 };
+    StegHeader hdr;
+    unsigned char *volatile out = NULL;  // Set after sigsetjmp, so kept out of registers
+    volatile size_t out_size = 0;
+    sigjmp_buf jmp;
+
+    if (map_input(fds[0], &image, "stego image", 0, reply) == e_failure)
+    {
+        goto unmap;
+    }
+    if (sigsetjmp(jmp, 1) != 0)
+    {
+        fault_jmp = NULL;
+        reply_error(reply, "A file was truncated during the request");
+    }
+    else
+    {
+        fault_jmp = &jmp;
+        if (steg_read_header(image.addr, image.size, req->magic, &hdr, NULL) == e_failure)
+        {
+            reply_error(reply, steg_last_error());
+        }
+        else
+        {
+            out_size = hdr.secret_size;
+            out = map_output_fd(fds[1], out_size);
+            if (out == MAP_FAILED)
+            {
+                out = NULL;
+                reply_error(reply, "Unable to map the output file");
+            }
+            else if (steg_extract(image.addr, image.size, &hdr, &opts, out, NULL) == e_failure)
+            {
+                reply_error(reply, steg_last_error());
+            }
+            else
+            {
+                reply->size = hdr.secret_size;
+                snprintf(reply->extn, sizeof(reply->extn), "%s", hdr.extn);
+            }
+        }
+        fault_jmp = NULL;
+    }
+    if (out != NULL)
+    {
+        munmap(out, out_size);
+    }
+unmap:
+    unmap_input(&image);
+}
+
+/* Receive one request and the descriptors sent with it; returns the bytes read, 0 at end of stream */
+static ssize_t recv_request(int conn, ServerRequest *req, int *fds, int *nfds)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(SERVER_MAX_FDS * sizeof(int))];
+    } ctrl;
+    struct iovec iov = { req, sizeof(*req) };
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t n;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl.buf;
+    msg.msg_controllen = sizeof(ctrl.buf);
+    *nfds = 0;
+
+    do
+    {
+        n = recvmsg(conn, &msg, MSG_WAITALL | MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); n >= 0 && cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (int i = 0; i < count; i++)
+            {
+                int fd;
+                memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                if (*nfds < SERVER_MAX_FDS)
+                {
+                    fds[(*nfds)++] = fd;
+                }
+                else
+                {
+                    close(fd);  // More than any request uses
+                }
+            }
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC)
+    {
+        // Some descriptors were dropped, refuse the request
+        for (int i = 0; i < *nfds; i++)
+        {
+            close(fds[i]);
+        }
+        *nfds = -1;
+    }
+    return n;
+}
+
+/* Answer requests on one connection until the client closes it */
+static void serve_connection(int conn)
+{
+    ServerRequest req;
+    ServerReply reply;
+    int fds[SERVER_MAX_FDS];
+    int nfds;
+    ssize_t n;
+
+    while ((n = recv_request(conn, &req, fds, &nfds)) > 0)
+    {
+        memset(&reply, 0, sizeof(reply));
+        reply.status = e_success;
+        req.magic[sizeof(req.magic) - 1] = '\0';
+        req.extn[sizeof(req.extn) - 1] = '\0';
+
+        if ((size_t)n != sizeof(req) || nfds < 0)
+        {
+            reply_error(&reply, "Truncated request");
+        }
+        else if (req.op == 'e' && nfds == 3)
+        {
+            serve_encode(&req, fds, &reply);
+        }
+        else if (req.op == 'd' && nfds == 2)
+        {
+            serve_decode(&req, fds, &reply);
+        }
+        else
+        {
+            reply_error(&reply, "Unknown operation or wrong number of descriptors");
+        }
+
+        for (int i = 0; i < nfds; i++)
+        {
+            close(fds[i]);
+        }
+        if (send(conn, &reply, sizeof(reply), MSG_NOSIGNAL) != sizeof(reply) || (size_t)n != sizeof(req))
+        {
+            break;
+        }
+    }
+}
+
+static void serve_worker(size_t job, void *arg)
+{
+    Server *srv = arg;
+    (void)job;
+
+    for (;;)
+    {
+        int conn = accept(srv->listen_fd, NULL, NULL);
+        if (conn < 0)
+        {
+            if (errno != EINTR && errno != ECONNABORTED)
+            {
+                perror("accept");
+                sleep(1);  // Out of descriptors or memory, give the other connections time to finish
+            }
+            continue;
+        }
+        serve_connection(conn);
+        close(conn);
+    }
+}
+
+Status run_server(const char *socket_path, const StegOptions *opts)
+{
+    Server srv;
+    struct sockaddr_un addr;
+    struct stat st;
+
+    if (strlen(socket_path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "ERROR: Socket path %s is too long\n", socket_path);
+        return e_failure;
+    }
+    // Replace a socket left behind by an earlier server, never any other file
+    if (stat(socket_path, &st) == 0)
+    {
+        if (!S_ISSOCK(st.st_mode))
+        {
+            fprintf(stderr, "ERROR: %s exists and is not a socket\n", socket_path);
+            return e_failure;
+        }
+        unlink(socket_path);
+    }
+
+    srv.listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (srv.listen_fd < 0)
+    {
+        perror("socket");
+        return e_failure;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    if (bind(srv.listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(srv.listen_fd, SOMAXCONN) != 0)
+    {
+        perror("bind");
+        close(srv.listen_fd);
+        return e_failure;
+    }
+
+    // Each connection is served by one worker and each request runs single threaded
+    srv.num_workers = opts->num_threads > 0 ? opts->num_threads : sysconf(_SC_NPROCESSORS_ONLN);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGBUS, on_sigbus);
+    lsb_kernel_init();  // Pick the kernel before any worker thread uses it
+
+    LOG_INFO("INFO: Listening on %s with %d workers\n", socket_path, srv.num_workers);
+    fflush(stdout);
+    run_parallel(srv.num_workers, srv.num_workers, serve_worker, &srv);
+
+    close(srv.listen_fd);  // Only reached when the worker pool could not be set up
+    return e_failure;
+}
+
+#else
+
+Status run_server(const char *socket_path, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Server mode is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
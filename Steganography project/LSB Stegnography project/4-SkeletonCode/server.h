@@ -0,0 +1,53 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Server mode: one warm process answers encode/decode requests on a Unix
+ * stream socket. Files are never named on the wire; the client passes open
+ * descriptors with SCM_RIGHTS (regular files, memfd_create or shm_open
+ * objects all work) next to a fixed-size request:
+ *
+ *   encode: ServerRequest op 'e' + fds { image, secret, output }
+ *   decode: ServerRequest op 'd' + fds { stego image, output }
+ *
+ * The output descriptor must be open for reading and writing; it is
+ * resized to the stego image or decoded secret. The image must be a
+ * non-empty regular file; a file truncated by the client mid-request
+ * fails that request only. Every request gets one
+ * ServerReply. A connection may send any number of requests in turn and
+ * connections are served concurrently by a pool of worker threads.
+ * All integers are in host byte order.
+ */
+
+#define SERVER_MAX_FDS 3
+#define SERVER_STR_SIZE 16
+
+typedef struct _ServerRequest
+{
+    uint op;                        // 'e' or 'd'
+    uint lsb_depth;                 // Encode only, 0 means 1
+    uint compress;                  // Encode only, non-zero for LZ
+    char magic[SERVER_STR_SIZE];    // Magic string, NUL terminated
+    char extn[SERVER_STR_SIZE];     // Encode only, secret file extension with its dot
+} ServerRequest;
+
+typedef struct _ServerReply
+{
+    unsigned long long size;        // Bytes written to the output descriptor
+    uint status;                    // e_success or e_failure
+    char extn[SERVER_STR_SIZE];     // Decode only, extension of the hidden file
+    char error[100];                // Reason when status is e_failure
+} ServerReply;
+
+/* Listen on socket_path and serve requests until the process is killed */
+Status run_server(const char *socket_path, const StegOptions *opts);
+
+#endif
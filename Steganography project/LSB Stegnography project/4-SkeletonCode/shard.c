@@ -0,0 +1,475 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "shard.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lsb_steg.h"
+#include "lsb_kernel.h"
+#include "mmap_engine.h"
+#include "parallel.h"
+#include "crc32c.h"
+
+/* One carrier of the set and everything its worker needs */
+typedef struct _ShardJob
+{
+    const char *fname;          // Carrier or stego image
+    char *out_fname;            // Encode only, the stego image written
+    unsigned char *image;       // Mapping of fname
+    size_t image_size;
+    size_t capacity;            // Encode only, secret bytes the carrier can hold
+    StegHeader hdr;             // Decode only, header found in the image
+    StegShard shard;
+    Status status;
+} ShardJob;
+
+typedef struct _ShardSet
+{
+    ShardJob *jobs;
+    size_t njobs;
+    const unsigned char *secret;    // Whole secret, mapped when encoding and written when decoding
+    unsigned char *out;
+    const char *extn;
+    const char *magic;
+    StegOptions job_opts;           // Options every shard runs with
+} ShardSet;
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Map fname read-only; an empty file maps to NULL */
+static unsigned char *map_input(const char *fname, size_t *size)
+{
+    struct stat st;
+    unsigned char *addr;
+    int fd = open(fname, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return MAP_FAILED;
+    }
+    *size = st.st_size;
+    addr = map_file(fd, *size, PROT_READ);
+    close(fd);  // The mapping keeps the file referenced
+    return addr;
+}
+
+static void unmap_jobs(ShardSet *set)
+{
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        if (set->jobs[i].image != NULL && set->jobs[i].image != MAP_FAILED)
+        {
+            munmap(set->jobs[i].image, set->jobs[i].image_size);
+        }
+        free(set->jobs[i].out_fname);
+    }
+    free(set->jobs);
+}
+
+/* Worker count from -j, the threads left over go to each shard's slabs */
+static int split_threads(const StegOptions *opts, size_t njobs, StegOptions *job_opts)
+{
+    int nworkers = opts->num_threads > 0 ? opts->num_threads : sysconf(_SC_NPROCESSORS_ONLN);
+
+    *job_opts = *opts;
+    job_opts->num_threads = (size_t)nworkers > njobs ? nworkers / njobs : 1;
+    lsb_kernel_init();  // Pick the kernel before any worker thread uses it
+    return nworkers;
+}
+
+/* Give each carrier a part in proportion to its capacity, so they all finish at about the same time */
+static Status plan_shards(ShardSet *set, size_t total, uint set_id)
+{
+    size_t sum = 0, assigned = 0, offset = 0;
+
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        sum += set->jobs[i].capacity;
+    }
+    if (total > sum)
+    {
+        fprintf(stderr, "ERROR: The carriers hold %zu bytes, the secret has %zu\n", sum, total);
+        return e_failure;
+    }
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        ShardJob *job = &set->jobs[i];
+        size_t size = (size_t)((double)total * job->capacity / sum);
+        job->shard.size = size < job->capacity ? size : job->capacity;
+        assigned += job->shard.size;
+    }
+    // Rounding leaves fewer bytes than carriers, hand them to whoever has room
+    for (size_t i = 0; i < set->njobs && assigned < total; i++)
+    {
+        ShardJob *job = &set->jobs[i];
+        size_t extra = job->capacity - job->shard.size;
+        extra = extra < total - assigned ? extra : total - assigned;
+        job->shard.size += extra;
+        assigned += extra;
+    }
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        ShardJob *job = &set->jobs[i];
+        job->shard.set_id = set_id;
+        job->shard.index = i;
+        job->shard.count = set->njobs;
+        job->shard.offset = offset;
+        job->shard.total_size = total;
+        offset += job->shard.size;
+    }
+    return e_success;
+}
+
+static void encode_shard_job(size_t index, void *arg)
+{
+    ShardSet *set = arg;
+    ShardJob *job = &set->jobs[index];
+    unsigned char *out;
+    int fd = open(job->out_fname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+
+    job->status = e_failure;
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", job->out_fname);
+        return;
+    }
+    out = map_output_fd(fd, job->image_size);
+    close(fd);
+    if (out == MAP_FAILED)
+    {
+        return;
+    }
+    job->status = steg_embed_shard(job->image, job->image_size, set->secret, &job->shard, set->extn,
+                                   set->magic, &set->job_opts, out, NULL);
+    if (job->status == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", job->out_fname, steg_last_error());
+    }
+    munmap(out, job->image_size);
+}
+
+Status do_shard_encode(const char *secret_fname, const char *out_prefix, char *carriers[], int ncarriers,
+                       const char *magic, const StegOptions *opts)
+{
+    ShardSet set;
+    size_t secret_size = 0;
+    unsigned char *secret;
+    int nworkers;
+    double start = get_time_sec();
+    Status ret = e_failure;
+
+    memset(&set, 0, sizeof(set));
+    set.extn = secret_file_extn(secret_fname);  // Empty for a name without a dot
+    set.magic = magic;
+    if (strlen(set.extn) >= STEG_MAX_EXTN)
+    {
+        fprintf(stderr, "ERROR: %s has too long a file extension\n", secret_fname);
+        return e_failure;
+    }
+    if (ncarriers > STEG_MAX_SHARDS)
+    {
+        fprintf(stderr, "ERROR: At most %d carriers\n", STEG_MAX_SHARDS);
+        return e_failure;
+    }
+    if (opts->channel_mask != 0)
+    {
+        fprintf(stderr, "ERROR: --channels cannot be used to split a secret\n");  // The split goes by whole-pixel capacity
+        return e_failure;
+    }
+    secret = map_input(secret_fname, &secret_size);
+    if (secret == MAP_FAILED)
+    {
+        return e_failure;
+    }
+    set.secret = secret;
+    set.jobs = calloc(ncarriers, sizeof(ShardJob));
+    if (set.jobs == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        goto unmap_secret;
+    }
+    set.njobs = ncarriers;
+    nworkers = split_threads(opts, set.njobs, &set.job_opts);
+
+    // Only the headers are read here, the pixel data is faulted in by the workers
+    for (size_t i = 0; i < set.njobs; i++)
+    {
+        ShardJob *job = &set.jobs[i];
+        job->fname = carriers[i];
+        job->image = map_input(job->fname, &job->image_size);
+        job->out_fname = malloc(strlen(out_prefix) + 16);
+        if (job->image == MAP_FAILED || job->out_fname == NULL ||
+            parse_bmp_info(job->image, job->image_size, job->image_size, &job->hdr.bmp) == e_failure)
+        {
+            fprintf(stderr, "ERROR: %s is not a usable BMP image\n", job->fname);
+            goto free_jobs;
+        }
+        sprintf(job->out_fname, "%s_%zu.bmp", out_prefix, i);
+        job->capacity = steg_capacity(job->hdr.bmp.carrier_size, strlen(magic), strlen(set.extn),
+                                      &set.job_opts, 1);
+    }
+    if (plan_shards(&set, secret_size, crc32c_update(0, secret, secret_size)) == e_failure)
+    {
+        goto free_jobs;
+    }
+    if (run_parallel(nworkers, set.njobs, encode_shard_job, &set) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto free_jobs;
+    }
+
+    ret = e_success;
+    for (size_t i = 0; i < set.njobs; i++)
+    {
+        ShardJob *job = &set.jobs[i];
+        LOG_INFO("INFO: Shard %u: %zu bytes at %zu in %s\n", job->shard.index, job->shard.size,
+                 job->shard.offset, job->out_fname);
+        ret = job->status == e_success ? ret : e_failure;
+    }
+    LOG_INFO("INFO: Split %zu bytes across %zu carriers with %d workers in %.3f s\n", secret_size,
+             set.njobs, nworkers, get_time_sec() - start);
+
+free_jobs:
+    unmap_jobs(&set);
+unmap_secret:
+    if (secret != NULL)
+    {
+        munmap(secret, secret_size);
+    }
+    return ret;
+}
+
+static void read_shard_job(size_t index, void *arg)
+{
+    ShardSet *set = arg;
+    ShardJob *job = &set->jobs[index];
+
+    job->status = e_failure;
+    job->image = map_input(job->fname, &job->image_size);
+    if (job->image == MAP_FAILED)
+    {
+        return;
+    }
+    if (steg_read_header(job->image, job->image_size, set->magic, &job->hdr, NULL) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", job->fname, steg_last_error());
+    }
+    else if (job->hdr.shard.count == 0)
+    {
+        fprintf(stderr, "ERROR: %s holds a whole secret, not a shard\n", job->fname);
+    }
+    else
+    {
+        job->status = e_success;
+    }
+}
+
+static void extract_shard_job(size_t index, void *arg)
+{
+    ShardSet *set = arg;
+    ShardJob *job = &set->jobs[index];
+
+    // Shards cover disjoint ranges of the output
+    job->status = steg_extract(job->image, job->image_size, &job->hdr, &set->job_opts,
+                               set->out + job->hdr.shard.offset, NULL);
+    if (job->status == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", job->fname, steg_last_error());
+    }
+}
+
+/* Check that the shards are one whole set and put them in index order */
+static Status check_shard_set(ShardSet *set)
+{
+    const StegShard *first = &set->jobs[0].hdr.shard;
+    ShardJob **by_index = calloc(set->njobs, sizeof(*by_index));
+    size_t offset = 0;
+    Status ret = e_failure;
+
+    if (by_index == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    if (set->njobs != first->count)
+    {
+        fprintf(stderr, "ERROR: The secret has %u shards, %zu given\n", first->count, set->njobs);
+        goto done;
+    }
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        ShardJob *job = &set->jobs[i];
+        const StegShard *shard = &job->hdr.shard;
+
+        if (shard->set_id != first->set_id || shard->count != first->count ||
+            shard->total_size != first->total_size || strcmp(job->hdr.extn, set->jobs[0].hdr.extn) != 0)
+        {
+            fprintf(stderr, "ERROR: %s belongs to a different secret than %s\n", job->fname, set->jobs[0].fname);
+            goto done;
+        }
+        if (by_index[shard->index] != NULL)
+        {
+            fprintf(stderr, "ERROR: %s and %s are both shard %u\n", by_index[shard->index]->fname,
+                    job->fname, shard->index);
+            goto done;
+        }
+        by_index[shard->index] = job;
+    }
+    for (size_t i = 0; i < set->njobs; i++)
+    {
+        if (i > 0 && by_index[i]->hdr.shard.offset != offset)
+        {
+            fprintf(stderr, "ERROR: Shard %zu does not start where shard %zu ends\n", i, i - 1);
+            goto done;
+        }
+        offset += by_index[i]->hdr.shard.size;
+    }
+    if (offset != first->total_size)
+    {
+        fprintf(stderr, "ERROR: The shards do not cover the secret\n");
+        goto done;
+    }
+    ret = e_success;
+done:
+    free(by_index);
+    return ret;
+}
+
+Status do_shard_decode(const char *out_fname, char *images[], int nimages,
+                       const char *magic, const StegOptions *opts)
+{
+    ShardSet set;
+    char *fname = NULL;
+    size_t total;
+    int fd, nworkers;
+    double start = get_time_sec();
+    Status ret = e_failure;
+
+    memset(&set, 0, sizeof(set));
+    set.magic = magic;
+    set.jobs = calloc(nimages, sizeof(ShardJob));
+    if (set.jobs == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    set.njobs = nimages;
+    nworkers = split_threads(opts, set.njobs, &set.job_opts);
+    for (size_t i = 0; i < set.njobs; i++)
+    {
+        set.jobs[i].fname = images[i];
+    }
+
+    // Every header first, the output size and each shard's place depend on all of them
+    if (run_parallel(nworkers, set.njobs, read_shard_job, &set) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto free_jobs;
+    }
+    for (size_t i = 0; i < set.njobs; i++)
+    {
+        if (set.jobs[i].status == e_failure)
+        {
+            goto free_jobs;
+        }
+    }
+    if (check_shard_set(&set) == e_failure)
+    {
+        goto free_jobs;
+    }
+
+    // The decoded extension replaces the one given on the command line
+    fname = malloc(strlen(out_fname) + STEG_MAX_EXTN);
+    if (fname == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        goto free_jobs;
+    }
+    strcpy(fname, out_fname);
+    strcpy(fname + secret_file_stem_len(out_fname), set.jobs[0].hdr.extn);
+
+    total = set.jobs[0].hdr.shard.total_size;
+    fd = open(fname, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", fname);
+        goto free_jobs;
+    }
+    set.out = map_output_fd(fd, total);
+    close(fd);
+    if (set.out == MAP_FAILED)
+    {
+        goto free_jobs;
+    }
+
+    if (run_parallel(nworkers, set.njobs, extract_shard_job, &set) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+    }
+    else
+    {
+        ret = e_success;
+        for (size_t i = 0; i < set.njobs; i++)
+        {
+            ret = set.jobs[i].status == e_success ? ret : e_failure;
+        }
+    }
+    if (set.out != NULL)
+    {
+        munmap(set.out, total);
+    }
+    if (ret == e_success)
+    {
+        LOG_INFO("INFO: Joined %zu shards into %s (%zu bytes) with %d workers in %.3f s\n", set.njobs,
+                 fname, total, nworkers, get_time_sec() - start);
+    }
+
+free_jobs:
+    free(fname);
+    unmap_jobs(&set);
+    return ret;
+}
+
+#else
+
+Status do_shard_encode(const char *secret_fname, const char *out_prefix, char *carriers[], int ncarriers,
+                       const char *magic, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Sharded mode is not supported on this platform\n");
+    return e_failure;
+}
+
+Status do_shard_decode(const char *out_fname, char *images[], int nimages,
+                       const char *magic, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Sharded mode is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Sharded mode: one secret split across several carrier images. Each
+ * carrier takes a part in proportion to what it can hold, and its header
+ * records the shard index and count, where the part starts, the size of
+ * the whole secret and a set id (the CRC32C of the whole secret) so that
+ * shards of different secrets are never mixed.
+ *
+ * Every shard is embedded on its own worker and written to
+ * <output prefix>_<index>.bmp. Decoding takes the stego images in any
+ * order, reads all their headers, checks that they make up one whole set
+ * and extracts every shard straight to its place in the output file.
+ */
+
+/* Split secret_fname across the carriers */
+Status do_shard_encode(const char *secret_fname, const char *out_prefix, char *carriers[], int ncarriers,
+                       const char *magic, const StegOptions *opts);
+
+/* Rebuild the secret from every shard of one set; the decoded extension replaces out_fname's */
+Status do_shard_decode(const char *out_fname, char *images[], int nimages,
+                       const char *magic, const StegOptions *opts);
+
+#endif
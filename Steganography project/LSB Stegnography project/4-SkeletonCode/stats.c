@@ -0,0 +1,134 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+int steg_verbose = 0;
+
+static _Thread_local const char *steg_error = "No error";
+
+void steg_set_error(const char *msg)
+{
+    steg_error = msg;
+}
+
+const char *steg_last_error(void)
+{
+    return steg_error;
+}
+
+static double get_time_sec(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void stats_init(StegStats *st, const char *operation, const char *engine)
+{
+    memset(st, 0, sizeof(*st));
+    st->operation = operation;
+    st->engine = engine;
+    st->compressed = -1;
+}
+
+void stats_phase(StegStats *st, const char *name, long long read, long long written, long long carrier)
+{
+    double now;
+
+    if (st == NULL)
+    {
+        return;
+    }
+    now = get_time_sec();
+
+    if (st->open != NULL && st->nphases < STATS_MAX_PHASES)
+    {
+        StegPhase *ph = &st->phase[st->nphases++];
+        ph->name = st->open;
+        ph->sec = now - st->start;
+        ph->bytes_read = read - st->read;
+        ph->bytes_written = written - st->written;
+        ph->carrier_bytes = carrier - st->carrier;
+    }
+
+    st->open = name;
+    st->start = now;
+    st->read = read;
+    st->written = written;
+    st->carrier = carrier;
+}
+
+static void print_json_phase(const StegPhase *ph, FILE *fptr)
+{
+    fprintf(fptr, "{\"name\": \"%s\", \"seconds\": %.6f, \"bytes_read\": %lld, \"bytes_written\": %lld, "
+            "\"carrier_bytes\": %lld, \"mb_per_s\": %.1f}",
+            ph->name, ph->sec, ph->bytes_read, ph->bytes_written, ph->carrier_bytes,
+            ph->sec > 0 ? (ph->bytes_read + ph->bytes_written) / ph->sec / (1024 * 1024) : 0.0);
+}
+
+static void print_prometheus(const StegStats *st, const StegPhase *ph, FILE *fptr)
+{
+    fprintf(fptr, "lsb_steg_phase_seconds{operation=\"%s\",engine=\"%s\",phase=\"%s\"} %.6f\n",
+            st->operation, st->engine, ph->name, ph->sec);
+    fprintf(fptr, "lsb_steg_phase_bytes_read{operation=\"%s\",engine=\"%s\",phase=\"%s\"} %lld\n",
+            st->operation, st->engine, ph->name, ph->bytes_read);
+    fprintf(fptr, "lsb_steg_phase_bytes_written{operation=\"%s\",engine=\"%s\",phase=\"%s\"} %lld\n",
+            st->operation, st->engine, ph->name, ph->bytes_written);
+    fprintf(fptr, "lsb_steg_phase_carrier_bytes{operation=\"%s\",engine=\"%s\",phase=\"%s\"} %lld\n",
+            st->operation, st->engine, ph->name, ph->carrier_bytes);
+}
+
+void stats_print(const StegStats *st, int format, FILE *fptr)
+{
+    StegPhase total = { "total", 0, 0, 0, 0 };
+
+    for (int i = 0; i < st->nphases; i++)
+    {
+        total.sec += st->phase[i].sec;
+        total.bytes_read += st->phase[i].bytes_read;
+        total.bytes_written += st->phase[i].bytes_written;
+        total.carrier_bytes += st->phase[i].carrier_bytes;
+    }
+
+    if (format == STATS_PROMETHEUS)
+    {
+        fprintf(fptr, "# HELP lsb_steg_phase_seconds Wall time of each encode/decode phase\n"
+                      "# TYPE lsb_steg_phase_seconds gauge\n"
+                      "# TYPE lsb_steg_phase_bytes_read gauge\n"
+                      "# TYPE lsb_steg_phase_bytes_written gauge\n"
+                      "# TYPE lsb_steg_phase_carrier_bytes gauge\n");
+        for (int i = 0; i < st->nphases; i++)
+        {
+            print_prometheus(st, &st->phase[i], fptr);
+        }
+        print_prometheus(st, &total, fptr);
+        if (st->compressed >= 0)
+        {
+            fprintf(fptr, "# TYPE lsb_steg_compressed_bytes gauge\n"
+                          "lsb_steg_compressed_bytes{operation=\"%s\",engine=\"%s\"} %lld\n",
+                    st->operation, st->engine, st->compressed);
+        }
+        return;
+    }
+
+    fprintf(fptr, "{\"operation\": \"%s\", \"engine\": \"%s\", \"phases\": [", st->operation, st->engine);
+    for (int i = 0; i < st->nphases; i++)
+    {
+        fprintf(fptr, i == 0 ? "\n  " : ",\n  ");
+        print_json_phase(&st->phase[i], fptr);
+    }
+    fprintf(fptr, "],\n \"total\": ");
+    print_json_phase(&total, fptr);
+    if (st->compressed >= 0)
+    {
+        fprintf(fptr, ",\n \"compressed_bytes\": %lld", st->compressed);
+    }
+    fprintf(fptr, "}\n");
+}
@@ -0,0 +1,64 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+
+/* Progress lines are only printed with -v */
+extern int steg_verbose;
+#define LOG_INFO(...) do { if (steg_verbose) printf(__VA_ARGS__); } while (0)
+
+/* Record why a call failed; msg must be a string literal */
+void steg_set_error(const char *msg);
+
+/* Message for the last call that failed on this thread */
+const char *steg_last_error(void);
+
+/* --stats output formats */
+#define STATS_NONE 0
+#define STATS_JSON 1
+#define STATS_PROMETHEUS 2
+
+#define STATS_MAX_PHASES 8
+
+/* Wall time and I/O of one phase of encoding or decoding */
+typedef struct _StegPhase
+{
+    const char *name;
+    double sec;
+    long long bytes_read;       // Image and secret bytes read
+    long long bytes_written;    // Stego image or decoded file bytes written
+    long long carrier_bytes;    // Carrier bytes whose LSBs were rewritten or read
+} StegPhase;
+
+typedef struct _StegStats
+{
+    const char *operation;      // "encode" or "decode"
+    const char *engine;         // "stdio" or "mmap"
+    int nphases;
+    StegPhase phase[STATS_MAX_PHASES];
+    const char *open;           // Phase being timed, NULL between phases
+    double start;               // Start of the open phase
+    long long read, written, carrier;   // Running totals when it started
+    long long compressed;       // Secret data bytes as stored with -z, -1 when uncompressed
+} StegStats;
+
+void stats_init(StegStats *st, const char *operation, const char *engine);
+
+/*
+ * End the open phase and start the next one. The counters are running
+ * totals for the whole operation; each phase records the difference.
+ * A NULL name only ends the open phase. st may be NULL when --stats is off.
+ */
+void stats_phase(StegStats *st, const char *name, long long read, long long written, long long carrier);
+
+/* Print the phases and their totals as JSON or Prometheus text */
+void stats_print(const StegStats *st, int format, FILE *fptr);
+
+#endif
@@ -0,0 +1,279 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifdef __linux__
+#define _GNU_SOURCE  // memfd_create
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stream.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Block size used to read a piped stdin into memory */
+#define SPOOL_BUF_SIZE (64 * 1024)
+
+/* Leading bytes of a piped carrier kept so its headers can be read again */
+#define STREAM_PREFIX_SIZE (64 * 1024)
+
+static int data_stdout = -1;  // stdout as it was before stream_claim_stdout
+
+int stream_is_std(const char *fname)
+{
+    return fname != NULL && strcmp(fname, STREAM_NAME) == 0;
+}
+
+Status stream_claim_stdout(void)
+{
+    if (data_stdout >= 0)
+    {
+        return e_success;
+    }
+    fflush(stdout);
+    data_stdout = dup(STDOUT_FILENO);
+    if (data_stdout < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0)
+    {
+        perror("dup");
+        return e_failure;
+    }
+    return e_success;
+}
+
+/* Copy the rest of stdin into a seekable file that lives only in memory */
+static int spool_stdin(void)
+{
+    char buffer[SPOOL_BUF_SIZE];
+    ssize_t n;
+#ifdef __linux__
+    int fd = memfd_create("lsb_steg-stdin", MFD_CLOEXEC);
+#else
+    FILE *tmp = tmpfile();  // No memfd, an unlinked file holds it instead
+    int fd = tmp != NULL ? dup(fileno(tmp)) : -1;
+
+    if (tmp != NULL)
+    {
+        fclose(tmp);
+    }
+#endif
+
+    if (fd < 0)
+    {
+        perror("memfd_create");
+        return -1;
+    }
+    for (;;)
+    {
+        size_t done = 0;
+
+        n = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        while (done < (size_t)n)
+        {
+            ssize_t w = write(fd, buffer + done, n - done);
+            if (w < 0 && errno != EINTR)
+            {
+                perror("write");
+                close(fd);
+                return -1;
+            }
+            done += w > 0 ? w : 0;
+        }
+    }
+    if (n < 0 || lseek(fd, 0, SEEK_SET) != 0)
+    {
+        perror("read");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#ifdef __linux__
+/* A pipe read as it arrives; seeks may only go back into the kept prefix */
+typedef struct _SeqStream
+{
+    int fd;
+    off64_t pos;                // Next byte handed to stdio
+    off64_t read_end;           // Bytes read from fd so far
+    unsigned char prefix[STREAM_PREFIX_SIZE];
+} SeqStream;
+
+static ssize_t seq_read(void *cookie, char *buf, size_t size)
+{
+    SeqStream *s = cookie;
+    ssize_t n;
+
+    if (s->pos < s->read_end)
+    {
+        // Reading the headers again after a rewind
+        n = s->read_end - s->pos < (off64_t)size ? s->read_end - s->pos : (off64_t)size;
+        memcpy(buf, s->prefix + s->pos, n);
+        s->pos += n;
+        return n;
+    }
+    do
+    {
+        n = read(s->fd, buf, size);
+    } while (n < 0 && errno == EINTR);
+    if (n > 0)
+    {
+        if (s->pos < STREAM_PREFIX_SIZE)
+        {
+            memcpy(s->prefix + s->pos, buf, STREAM_PREFIX_SIZE - s->pos < n ? STREAM_PREFIX_SIZE - s->pos : n);
+        }
+        s->pos += n;
+        s->read_end = s->pos;
+    }
+    return n;
+}
+
+static int seq_seek(void *cookie, off64_t *offset, int whence)
+{
+    SeqStream *s = cookie;
+    off64_t target = whence == SEEK_SET ? *offset : whence == SEEK_CUR ? s->pos + *offset : -1;
+
+    // Everything read so far must still be in the prefix to go back
+    if (target != s->pos && (target < 0 || target > s->read_end || s->read_end > STREAM_PREFIX_SIZE))
+    {
+        errno = ESPIPE;
+        return -1;
+    }
+    s->pos = target;
+    *offset = target;
+    return 0;
+}
+
+static int seq_close(void *cookie)
+{
+    SeqStream *s = cookie;
+    int ret = close(s->fd);
+
+    free(s);
+    return ret;
+}
+
+/* Wrap fd so the image can be rewound to its headers without holding the rest */
+static FILE *open_sequential(int fd)
+{
+    cookie_io_functions_t io = { seq_read, NULL, seq_seek, seq_close };
+    SeqStream *s = malloc(sizeof(*s));
+    FILE *fptr;
+
+    if (s == NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+    s->fd = fd;
+    s->pos = 0;
+    s->read_end = 0;
+    fptr = fopencookie(s, "rb", io);
+    if (fptr == NULL)
+    {
+        free(s);
+        close(fd);
+    }
+    return fptr;
+}
+#endif
+
+FILE *stream_open_forward(const char *fname)
+{
+#ifdef __linux__
+    struct stat st;
+
+    if (stream_is_std(fname) && fstat(STDIN_FILENO, &st) == 0 && !S_ISREG(st.st_mode))
+    {
+        int fd = dup(STDIN_FILENO);
+        return fd >= 0 ? open_sequential(fd) : NULL;
+    }
+#endif
+    return stream_open(fname, "rb");  // Elsewhere a pipe is buffered whole
+}
+
+FILE *stream_open(const char *fname, const char *mode)
+{
+    struct stat st;
+    FILE *fptr;
+    int fd;
+
+    if (!stream_is_std(fname))
+    {
+        return fopen(fname, mode);
+    }
+
+    if (mode[0] == 'r')
+    {
+        // A redirected regular file is used as it is
+        if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode))
+        {
+            fd = dup(STDIN_FILENO);
+        }
+        else
+        {
+            fd = spool_stdin();
+        }
+    }
+    else
+    {
+        fd = dup(data_stdout >= 0 ? data_stdout : STDOUT_FILENO);
+    }
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    fptr = fdopen(fd, mode);
+    if (fptr == NULL)
+    {
+        close(fd);
+    }
+    return fptr;
+}
+
+#else
+
+int stream_is_std(const char *fname)
+{
+    return fname != NULL && strcmp(fname, STREAM_NAME) == 0;
+}
+
+Status stream_claim_stdout(void)
+{
+    fprintf(stderr, "ERROR: Streaming through stdout is not supported on this platform\n");
+    return e_failure;
+}
+
+FILE *stream_open(const char *fname, const char *mode)
+{
+    if (stream_is_std(fname))
+    {
+        fprintf(stderr, "ERROR: Streaming through stdin or stdout is not supported on this platform\n");
+        return NULL;
+    }
+    return fopen(fname, mode);
+}
+
+FILE *stream_open_forward(const char *fname)
+{
+    return stream_open(fname, "rb");
+}
+
+#endif
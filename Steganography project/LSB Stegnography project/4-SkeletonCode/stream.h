@@ -0,0 +1,41 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdio.h>
+#include "types.h" // Contains user defined types
+
+/*
+ * "-" as a file name: stdin for the carrier, secret or stego image read,
+ * stdout for the image or secret written, so the tool can sit in a shell
+ * pipeline. A piped carrier is read as it arrives: the encoder only goes
+ * back to reread its headers, which stay in a small prefix buffer. The
+ * secret length is stored ahead of its data, and decoding may reread an
+ * old layout image, so a piped secret or stego image is first read whole
+ * into an anonymous memory file (memfd) and is then seekable like any
+ * other file. Output is written front to back and needs no seeking.
+ */
+
+#define STREAM_NAME "-"
+
+/* Whether fname stands for stdin or stdout */
+int stream_is_std(const char *fname);
+
+/* Keep stdout for the data and send every message printed from here on to stderr */
+Status stream_claim_stdout(void);
+
+/* fopen that maps "-" to stdin when reading and stdout when writing */
+FILE *stream_open(const char *fname, const char *mode);
+
+/*
+ * Open a file that is read front to back for reading. A piped stdin is not
+ * buffered; only rewinds within its first 64 KB work and its size is unknown.
+ */
+FILE *stream_open_forward(const char *fname);
+
+#endif
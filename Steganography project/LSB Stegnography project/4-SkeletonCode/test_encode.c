@@ -5,31 +5,116 @@ Description : Implementation of LSB image Steganography project
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include<string.h>
+#include <unistd.h>
 #include "encode.h"
 #include "types.h"
 #include "decode.h"
+#include "mmap_engine.h"
+#include "batch.h"
+#include "server.h"
+#include "scan.h"
+#include "shard.h"
+#include "archive.h"
+#include "catalog.h"
+#include "update.h"
+#include "stream.h"
 
 int main(int argc, char* argv[])
 {
     EncodeInfo encInfo;
     DecodeInfo decInfo;
-    uint img_size;
+    StegOptions opts;
+    StegStats stats;
+
+    // Pull option flags out so the positional arguments stay where they were
+    argc = parse_options(argc, argv, &opts);
+    if (argc < 0)
+    {
+        return 1;
+    }
 
     // Check if required line arguments are provided
     if (argc == 1) 
     {
-        printf("./lsb_steg : Encoding : ./lsb_steg -e <.bmp file> <secret file> [optional : .bmp file]\n");
-        printf("./lsb_steg : Encoding : ./lsb_steg -d <.bmp file> [optional : .txt file]\n");
+        printf("./lsb_steg : Encoding : ./lsb_steg -e <.bmp file> <secret file> [optional : .bmp file] [options]\n");
+        printf("                        ./lsb_steg -e <secret file> [optional : .bmp file] --pick=<catalog> [options]\n");
+        printf("./lsb_steg : Decoding : ./lsb_steg -d <.bmp file> [optional : .txt file] [options]\n");
+        printf("./lsb_steg : Update   : ./lsb_steg -u <stego .bmp file> [secret file] [options]\n");
+        printf("./lsb_steg : Batch    : ./lsb_steg -b <manifest file> [options]\n");
+        printf("./lsb_steg : Server   : ./lsb_steg -s <socket path> [-j <workers>]\n");
+        printf("./lsb_steg : Probe    : ./lsb_steg -p <magic string> <directory or .bmp file>... [-j <workers>]\n");
+        printf("./lsb_steg : Sharded  : ./lsb_steg -E <secret file> <output prefix> <.bmp file>... [options]\n");
+        printf("                        ./lsb_steg -D <output file> <.bmp file>... [options]\n");
+        printf("./lsb_steg : Archive  : ./lsb_steg -a <.bmp file> <output .bmp file> <file>... [options]\n");
+        printf("                        ./lsb_steg -d <.bmp file> -l\n");
+        printf("                        ./lsb_steg -d <.bmp file> [output file] -x <name> [--range=<offset>:<length>]\n");
+        printf("./lsb_steg : Catalog  : ./lsb_steg -c <catalog> <directory or .bmp file>... [-j <workers>]\n");
+        printf("Options : -m, --mmap  use the memory-mapped engine\n");
+        printf("          -j <N>      use N threads (implies -m), or N batch/server workers\n");
+        printf("          -k <N>      store N bits (1-4) in each image byte when encoding\n");
+        printf("          -z          compress the secret data when encoding\n");
+        printf("          -v          print progress for each step\n");
+        printf("          --stats[=json|prom]  print per-phase time and byte counts to stderr\n");
+        printf("          --pipeline  read ahead and write behind on I/O threads (without -m)\n");
+        printf("          --channels=<bgra>  hide data only in these channels of each pixel when encoding\n");
+        printf("          -l          list the files of an archive\n");
+        printf("          -x <name>   extract one file of an archive, or --range=<offset>:<length> of it\n");
+        printf("          --pick=<catalog>  encode into the smallest carrier in the catalog that fits\n");
+        printf("          --magic=<string>, --magic-fd=<N>  take the magic string from here, or from LSB_STEG_MAGIC,\n");
+        printf("                      instead of prompting for it\n");
+        printf("A file name of - reads the image or secret from stdin, or writes the output to stdout.\n");
+        printf("A piped image to encode into is streamed; a piped secret or stego image is held in memory first.\n");
         return 1; 
     }
 
     // Determine operation type (encoding or decoding)
     int ret = check_operation_type(argv);
+
+    // Threads work on the mapped image, so -j selects the mmap engine for a single encode or decode
+    if (opts.num_threads > 0 && (ret == e_encode || ret == e_decode))
+    {
+        opts.use_mmap = 1;
+    }
+
+    // Output written to stdout keeps it to itself, every message goes to stderr instead
+    int out_arg = ret == e_encode ? (opts.catalog != NULL ? 3 : 4) : ret == e_decode ? 3 : 0;
+    if (out_arg > 0 && out_arg < argc && stream_is_std(argv[out_arg]) &&
+        !opts.list_archive && opts.extract_name == NULL && stream_claim_stdout() == e_failure)
+    {
+        return 1;
+    }
     
     if (ret == e_encode) // Encoding operation
     {
         printf("----------Encoding operation selected----------\n");
+        char picked[4096];
+        char *pick_argv[6];
+
+        // Carrier from the catalog: the secret moves to argv[3] as if the carrier had been given
+        if (opts.catalog != NULL)
+        {
+            if (argc < 3)
+            {
+                printf("Error! Invalid command line argument.\n");
+                return 1;
+            }
+            if (catalog_pick(opts.catalog, argv[2], &opts, picked, sizeof(picked)) == e_failure)
+            {
+                printf("Error! No carrier picked.\n");
+                return 1;
+            }
+            pick_argv[0] = argv[0];
+            pick_argv[1] = argv[1];
+            pick_argv[2] = picked;
+            pick_argv[3] = argv[2];
+            pick_argv[4] = argc > 3 ? argv[3] : NULL;
+            pick_argv[5] = NULL;
+            argv = pick_argv;
+            argc++;
+        }
+
         // Ensure sufficient command-line arguments for encoding
         if (argc < 4)
         {
@@ -47,6 +132,14 @@ int main(int argc, char* argv[])
         // Assign filenames for source image and secret file
         encInfo.src_image_fname = argv[2];
         encInfo.secret_fname = argv[3];
+        encInfo.opts = &opts;
+        if (opts.use_mmap && (stream_is_std(argv[2]) || stream_is_std(argv[3]) || (argc > 4 && stream_is_std(argv[4]))))
+        {
+            LOG_INFO("INFO: Streaming through stdin or stdout, using the stdio engine\n");
+            opts.use_mmap = 0;  // The mmap engine maps named files
+        }
+        stats_init(&stats, "encode", opts.use_mmap ? "mmap" : "stdio");
+        encInfo.stats = opts.stats_format != STATS_NONE ? &stats : NULL;
         
         // Set the stego image filename if provided, otherwise use default
         if (argc == 4)
@@ -66,19 +159,18 @@ int main(int argc, char* argv[])
         }
         else
         {
-            printf("INFO: Files opened successfully.\n");
+            LOG_INFO("INFO: Files opened successfully.\n");
         }
 
-        // Check if  source image can hold the secret data
-        if (check_capacity(argv, &encInfo) == e_failure)
+        // Check if  source image can hold the secret data; check_capacity prints why not
+        if (check_capacity(&encInfo) == e_failure)
         {
-            printf("Error! Source file size is below the required limit.\n");
             return 1;
         }
 
         // read magic string from user
-        printf("Enter the Magic String: ");
-        if (scanf("%s", encInfo.magic_string) != 1) 
+        if (read_magic_string(&opts, encInfo.magic_string, sizeof(encInfo.magic_string),
+                              stream_is_std(argv[2]) || stream_is_std(argv[3])) == e_failure)
         {
             printf("Error! Failed to read the magic string.\n");
             return 1;
@@ -86,9 +178,17 @@ int main(int argc, char* argv[])
 
         // Reset file pointer 
         rewind(encInfo.fptr_src_image);
-        do_encoding(&encInfo); // Function to encode secret data
+        if ((opts.use_mmap ? do_encoding_mmap(&encInfo) : do_encoding(&encInfo)) == e_failure) // Function to encode secret data
+        {
+            printf("Error! Encoding failed.\n");
+            return 1;
+        }
 
         printf("----------Encoding secret data completed.----------\n");
+        if (encInfo.stats != NULL)
+        {
+            stats_print(encInfo.stats, opts.stats_format, stderr);
+        }
 
         // Close all opened files
         fclose(encInfo.fptr_src_image);
@@ -106,12 +206,36 @@ int main(int argc, char* argv[])
         }
 
         // Validate that the provided file is a .bmp file
-        if (strcmp(strchr(argv[2], '.'), ".bmp") != 0)
+        if (!is_bmp_fname(argv[2]))
         {
             printf("Error! Invalid file format. Only .bmp is supported.\n");
             return 1;
         }
 
+        // Archives are listed or extracted a file at a time, straight from the mapped image
+        if (opts.list_archive || opts.extract_name != NULL)
+        {
+            char magic[20];
+
+            if (stream_is_std(argv[2]) || stream_is_std(argv[3]))
+            {
+                printf("Error! Archives are read from and extracted to named files.\n");
+                return 1;
+            }
+            if (read_magic_string(&opts, magic, sizeof(magic), 0) == e_failure)
+            {
+                printf("Error : Failed to read the magic string.\n");
+                return 1;
+            }
+            if (do_archive_decode(argv[2], argv[3], magic, &opts) == e_failure)
+            {
+                printf("Error! Decoding failed.\n");
+                return 1;
+            }
+            printf("----------Decoding secret data completed.----------\n");
+            return 0;
+        }
+
         // Set the decoded secret filename, or use default if not provided
         if (argv[3] == NULL)
         {
@@ -119,17 +243,20 @@ int main(int argc, char* argv[])
         }
         else
         {
-            int i;
-            for (i = 0; argv[3][i] != '.'; i++)
+            // The decoded extension replaces the one given
+            size_t len = secret_file_stem_len(argv[3]);
+            if (len >= sizeof(decInfo.secret_fname))
             {
-                decInfo.secret_fname[i] = argv[3][i];
+                printf("Error! Output file name is too long.\n");
+                return 1;
             }
-            decInfo.secret_fname[i] = '\0'; // Null-terminate the string
+            memcpy(decInfo.secret_fname, argv[3], len);
+            decInfo.secret_fname[len] = '\0'; // Null-terminate the string
         }
 
         // Ask user for the magic string
-        printf("Enter the Magic String: ");
-        if (scanf("%s", decInfo.magic_string) != 1) // Error handling for input
+        if (read_magic_string(&opts, decInfo.magic_string, sizeof(decInfo.magic_string),
+                              stream_is_std(argv[2])) == e_failure) // Error handling for input
         {
             printf("Error : Failed to read the magic string.\n");
             return 1;
@@ -137,22 +264,176 @@ int main(int argc, char* argv[])
 
         // Set the stego image filename for decoding
         decInfo.stego_image_fname = argv[2];
+        decInfo.opts = &opts;
+        if (opts.use_mmap && (stream_is_std(argv[2]) || stream_is_std(decInfo.secret_fname)))
+        {
+            LOG_INFO("INFO: Streaming through stdin or stdout, using the stdio engine\n");
+            opts.use_mmap = 0;  // The mmap engine maps named files
+        }
+        stats_init(&stats, "decode", opts.use_mmap ? "mmap" : "stdio");
+        decInfo.stats = opts.stats_format != STATS_NONE ? &stats : NULL;
+        decInfo.fptr_stego_image = NULL;
+        decInfo.fptr_secret = NULL;
 
         // Perform decoding operation
-        if (do_decoding(&decInfo) == e_failure)
+        if ((opts.use_mmap ? do_decoding_mmap(&decInfo) : do_decoding(&decInfo)) == e_failure)
         {
             printf("Error! Decoding failed.\n");
             return 1;
         }
 
         printf("----------Decoding secret data completed.----------\n");
+        if (decInfo.stats != NULL)
+        {
+            stats_print(decInfo.stats, opts.stats_format, stderr);
+        }
+
+        // Close the stego image and decoded secret files (the mmap engine leaves none open)
+        if (decInfo.fptr_stego_image != NULL)
+        {
+            fclose(decInfo.fptr_stego_image);
+        }
+        if (decInfo.fptr_secret != NULL)
+        {
+            fclose(decInfo.fptr_secret);
+        }
+    }
+    else if (ret == e_batch) // Batch of jobs from a manifest
+    {
+        if (argc < 3)
+        {
+            printf("Error! Invalid manifest argument.\n");
+            return 1;
+        }
+
+        if (do_batch(argv[2], &opts) == e_failure)
+        {
+            printf("Error! Some batch jobs failed.\n");
+            return 1;
+        }
+    }
+    else if (ret == e_serve) // Serve requests on a Unix socket
+    {
+        if (argc < 3)
+        {
+            printf("Error! Invalid socket argument.\n");
+            return 1;
+        }
+
+        if (run_server(argv[2], &opts) == e_failure)
+        {
+            printf("Error! Server failed.\n");
+            return 1;
+        }
+    }
+    else if (ret == e_probe) // List the images that carry the magic string
+    {
+        if (argc < 4)
+        {
+            printf("Error! Invalid probe arguments.\n");
+            return 1;
+        }
 
-        // Close the stego image file
-        fclose(decInfo.fptr_stego_image);
+        if (do_scan(argv + 3, argc - 3, argv[2], &opts) == e_failure)
+        {
+            return 1;
+        }
+    }
+    else if (ret == e_shard_encode || ret == e_shard_decode) // One secret across several images
+    {
+        char magic[20];
+
+        if (argc < (ret == e_shard_encode ? 5 : 4))
+        {
+            printf("Error! Invalid sharded mode arguments.\n");
+            return 1;
+        }
+
+        if (read_magic_string(&opts, magic, sizeof(magic), 0) == e_failure)
+        {
+            printf("Error! Failed to read the magic string.\n");
+            return 1;
+        }
+
+        if ((ret == e_shard_encode ? do_shard_encode(argv[2], argv[3], argv + 4, argc - 4, magic, &opts)
+                                   : do_shard_decode(argv[2], argv + 3, argc - 3, magic, &opts)) == e_failure)
+        {
+            printf("Error! Sharded %s failed.\n", ret == e_shard_encode ? "encoding" : "decoding");
+            return 1;
+        }
+        printf("----------Sharded %s completed.----------\n", ret == e_shard_encode ? "encoding" : "decoding");
+    }
+    else if (ret == e_archive) // Several files in one image
+    {
+        char magic[20];
+
+        printf("----------Archive operation selected----------\n");
+        if (argc < 5)
+        {
+            printf("Error! Invalid archive arguments.\n");
+            return 1;
+        }
+
+        if (read_magic_string(&opts, magic, sizeof(magic), 0) == e_failure)
+        {
+            printf("Error! Failed to read the magic string.\n");
+            return 1;
+        }
+
+        if (do_archive_encode(argv[2], argv[3], argv + 4, argc - 4, magic, &opts) == e_failure)
+        {
+            printf("Error! Encoding failed.\n");
+            return 1;
+        }
+        printf("----------Encoding secret data completed.----------\n");
+    }
+    else if (ret == e_update) // Replace the secret of a stego image in place
+    {
+        char magic[20];
+
+        printf("----------Update operation selected----------\n");
+        if (argc < 3)
+        {
+            printf("Error! Invalid update arguments.\n");
+            return 1;
+        }
+
+        // Without a secret file only an interrupted update is finished
+        if (argc == 3)
+        {
+            return update_recover(argv[2]) == e_success ? 0 : 1;
+        }
+
+        if (read_magic_string(&opts, magic, sizeof(magic), 0) == e_failure)
+        {
+            printf("Error! Failed to read the magic string.\n");
+            return 1;
+        }
+
+        if (do_update(argv[2], argv[3], magic, &opts) == e_failure)
+        {
+            printf("Error! Update failed.\n");
+            return 1;
+        }
+        printf("----------Update completed.----------\n");
+    }
+    else if (ret == e_catalog) // Index a carrier pool
+    {
+        if (argc < 4)
+        {
+            printf("Error! Invalid catalog arguments.\n");
+            return 1;
+        }
+
+        if (do_catalog(argv[2], argv + 3, argc - 3, &opts) == e_failure)
+        {
+            printf("Error! Catalog failed.\n");
+            return 1;
+        }
     }
     else // Invalid operation type
     {
-        printf("Error! Unsupported operation. Use -e for encoding or -d for decoding.\n");
+        printf("Error! Unsupported operation. Use -e for encoding, -d for decoding, -u for update, -a for archive, -c for catalog, -b for batch, -s for server, -p for probe or -E/-D for sharded mode.\n");
         return 1;
     }
 
@@ -169,8 +450,242 @@ OperationType check_operation_type(char *argv[]) // Function to determine operat
     {
         return e_decode;
     }
+    else if (argv[1][1] == 'b') // Check for batch flag
+    {
+        return e_batch;
+    }
+    else if (argv[1][1] == 's') // Check for server flag
+    {
+        return e_serve;
+    }
+    else if (argv[1][1] == 'p') // Check for probe flag
+    {
+        return e_probe;
+    }
+    else if (argv[1][1] == 'a') // Check for archive flag
+    {
+        return e_archive;
+    }
+    else if (argv[1][1] == 'u') // Check for update flag
+    {
+        return e_update;
+    }
+    else if (argv[1][1] == 'c') // Check for catalog flag
+    {
+        return e_catalog;
+    }
+    else if (argv[1][1] == 'E') // Check for sharded encoding flag
+    {
+        return e_shard_encode;
+    }
+    else if (argv[1][1] == 'D') // Check for sharded decoding flag
+    {
+        return e_shard_decode;
+    }
     else
     {
         return e_unsupported; // Unsupported operation
     }
 }
+
+int parse_options(int argc, char *argv[], StegOptions *opts) // Strip option flags from argv
+{
+    int i, n = 1;
+
+    memset(opts, 0, sizeof(*opts));
+    opts->lsb_depth = 1;
+    opts->magic_fd = -1;
+
+    // argv[1] is the operation, everything after it may be an option
+    for (i = 1; i < argc; i++)
+    {
+        if (i > 1 && (strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "--mmap") == 0))
+        {
+            opts->use_mmap = 1;
+        }
+        else if (i > 1 && strcmp(argv[i], "-j") == 0)
+        {
+            // For -e and -d, main also selects the mmap engine; elsewhere -j sizes the worker pool
+            if (i + 1 >= argc || (opts->num_threads = atoi(argv[i + 1])) < 1)
+            {
+                printf("Error! -j needs a thread count.\n");
+                return -1;
+            }
+            i++;
+        }
+        else if (i > 1 && strcmp(argv[i], "-k") == 0)
+        {
+            if (i + 1 >= argc || (opts->lsb_depth = atoi(argv[i + 1])) < 1 || opts->lsb_depth > MAX_LSB_DEPTH)
+            {
+                printf("Error! -k needs a depth from 1 to %d.\n", MAX_LSB_DEPTH);
+                return -1;
+            }
+            i++;
+        }
+        else if (i > 1 && (strcmp(argv[i], "-z") == 0 || strcmp(argv[i], "--compress") == 0))
+        {
+            opts->compress = 1;
+        }
+        else if (i > 1 && (strcmp(argv[i], "-v") == 0 || strcmp(argv[i], "--verbose") == 0))
+        {
+            steg_verbose = 1;
+        }
+        else if (i > 1 && (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=json") == 0))
+        {
+            opts->stats_format = STATS_JSON;
+        }
+        else if (i > 1 && strcmp(argv[i], "--stats=prom") == 0)
+        {
+            opts->stats_format = STATS_PROMETHEUS;
+        }
+        else if (i > 1 && strcmp(argv[i], "--pipeline") == 0)
+        {
+            opts->pipeline = 1;
+        }
+        else if (i > 1 && strncmp(argv[i], "--channels=", 11) == 0)
+        {
+            // Letters in pixel byte order: bit 0 blue, 1 green, 2 red, 3 alpha
+            const char *names = "bgra";
+            const char *c;
+
+            opts->channel_mask = 0;
+            for (c = argv[i] + 11; *c != '\0'; c++)
+            {
+                const char *p = strchr(names, *c);
+                if (p == NULL)
+                {
+                    printf("Error! --channels takes the letters b, g, r and a.\n");
+                    return -1;
+                }
+                opts->channel_mask |= 1u << (p - names);
+            }
+            if (opts->channel_mask == 0)
+            {
+                printf("Error! --channels needs at least one channel.\n");
+                return -1;
+            }
+        }
+        else if (i > 1 && (strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "--list") == 0))
+        {
+            opts->list_archive = 1;
+        }
+        else if (i > 1 && strcmp(argv[i], "-x") == 0)
+        {
+            if (i + 1 >= argc)
+            {
+                printf("Error! -x needs a file name.\n");
+                return -1;
+            }
+            opts->extract_name = argv[++i];
+        }
+        else if (i > 1 && strncmp(argv[i], "--range=", 8) == 0)
+        {
+            if (sscanf(argv[i] + 8, "%llu:%llu", &opts->range_offset, &opts->range_length) != 2)
+            {
+                printf("Error! --range needs <offset>:<length>.\n");
+                return -1;
+            }
+            opts->has_range = 1;
+        }
+        else if (i > 1 && strncmp(argv[i], "--pick=", 7) == 0 && argv[i][7] != '\0')
+        {
+            opts->catalog = argv[i] + 7;
+        }
+        else if (i > 1 && strncmp(argv[i], "--magic=", 8) == 0)
+        {
+            opts->magic = argv[i] + 8;
+        }
+        else if (i > 1 && strncmp(argv[i], "--magic-fd=", 11) == 0)
+        {
+            if (sscanf(argv[i] + 11, "%d", &opts->magic_fd) != 1 || opts->magic_fd < 0)
+            {
+                printf("Error! --magic-fd needs a file descriptor.\n");
+                return -1;
+            }
+        }
+        else if (i > 1 && strncmp(argv[i], "--", 2) == 0)
+        {
+            printf("Error! Unknown option %s\n", argv[i]);
+            return -1;
+        }
+        else
+        {
+            argv[n++] = argv[i];
+        }
+    }
+    argv[n] = NULL;
+
+    return n;
+}
+
+Status read_magic_string(const StegOptions *opts, char *magic, size_t size, int stdin_busy)
+{
+    const char *src = opts->magic;
+    size_t len = 0;
+
+    // The flags come before the environment, the prompt last
+    if (src == NULL && opts->magic_fd < 0)
+    {
+        src = getenv("LSB_STEG_MAGIC");
+    }
+    if (src == NULL && opts->magic_fd >= 0)
+    {
+        // One line from the descriptor, the way a secret is passed to a pipeline
+        char ch;
+        ssize_t n;
+
+        while ((n = read(opts->magic_fd, &ch, 1)) == 1 && ch != '\n')
+        {
+            if (len + 1 >= size)
+            {
+                fprintf(stderr, "ERROR: The magic string is longer than %zu characters\n", size - 1);
+                return e_failure;
+            }
+            magic[len++] = ch;
+        }
+        if (n < 0)
+        {
+            perror("read");
+            return e_failure;
+        }
+        if (len > 0 && magic[len - 1] == '\r')
+        {
+            len--;
+        }
+        magic[len] = '\0';
+    }
+    else if (src != NULL)
+    {
+        len = strlen(src);
+        if (len >= size)
+        {
+            fprintf(stderr, "ERROR: The magic string is longer than %zu characters\n", size - 1);
+            return e_failure;
+        }
+        strcpy(magic, src);
+    }
+    else
+    {
+        char format[16];
+
+        if (stdin_busy)
+        {
+            fprintf(stderr, "ERROR: stdin holds the data, pass the magic string with --magic, --magic-fd or LSB_STEG_MAGIC\n");
+            return e_failure;
+        }
+        printf("Enter the Magic String: ");
+        snprintf(format, sizeof(format), "%%%zus", size - 1);
+        if (scanf(format, magic) != 1)
+        {
+            return e_failure;
+        }
+        len = strlen(magic);
+    }
+
+    if (len == 0)
+    {
+        fprintf(stderr, "ERROR: The magic string is empty\n");
+        return e_failure;
+    }
+    return e_success;
+}
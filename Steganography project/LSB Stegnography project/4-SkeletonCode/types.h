@@ -15,7 +15,35 @@ typedef enum
 {
     e_encode,
     e_decode,
+    e_batch,
+    e_serve,
+    e_probe,
+    e_shard_encode,
+    e_shard_decode,
+    e_archive,
+    e_catalog,
+    e_update,
     e_unsupported
 } OperationType;
 
+/* Command line options that pick how encoding/decoding runs */
+typedef struct _StegOptions
+{
+    int use_mmap;               // Use the memory-mapped engine
+    int num_threads;            // Worker threads (-j), 0 when not given
+    int lsb_depth;              // LSB bits used per carrier byte (-k), 1 to 4
+    int compress;               // Compress the secret data before embedding (-z)
+    int stats_format;           // Per-phase stats printed after the run (--stats), STATS_NONE when off
+    int pipeline;               // Overlap image reads and writes with the LSB work (--pipeline)
+    uint channel_mask;          // Carrier channels of each pixel (--channels), 0 for all of them
+    int list_archive;           // List the files of an archive (-l)
+    const char *extract_name;   // Archive file to extract (-x), NULL when not given
+    int has_range;              // Extract only part of that file (--range)
+    unsigned long long range_offset;
+    unsigned long long range_length;
+    const char *catalog;        // Pick the carrier from this catalog (--pick), NULL when not given
+    const char *magic;          // Magic string (--magic), NULL to read it from magic_fd, LSB_STEG_MAGIC or stdin
+    int magic_fd;               // Descriptor to read the magic string from (--magic-fd), -1 when not given
+} StegOptions;
+
 #endif
@@ -0,0 +1,456 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "update.h"
+#include "common.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "lsb_steg.h"
+#include "mmap_engine.h"
+#include "crc32c.h"
+
+#define JOURNAL_MAGIC "LSBJRN1"
+#define JOURNAL_SUFFIX ".journal"
+
+/* Journal file, in host byte order: the header, then count records each followed by its bytes */
+typedef struct _JournalHeader
+{
+    char magic[8];                      // JOURNAL_MAGIC
+    unsigned long long image_size;      // Size of the image the records apply to
+    unsigned long long body_size;       // Bytes after the header
+    uint count;                         // Records
+    uint crc;                           // CRC32C of the bytes after the header
+} JournalHeader;
+
+typedef struct _JournalRecord
+{
+    unsigned long long offset;          // File offset in the image
+    unsigned long long len;             // Bytes that follow the record
+} JournalRecord;
+
+/* Unchanged bytes inside a run that cost less to rewrite than a new record */
+#define RUN_GAP sizeof(JournalRecord)
+
+/* Records and their bytes, built in memory before the journal is written */
+typedef struct _JournalBody
+{
+    unsigned char *data;
+    size_t size;
+    size_t cap;
+    uint count;
+    size_t changed;                     // Image bytes the records rewrite
+} JournalBody;
+
+static char *journal_name(const char *image_fname)
+{
+    char *name = malloc(strlen(image_fname) + sizeof(JOURNAL_SUFFIX));
+
+    if (name != NULL)
+    {
+        sprintf(name, "%s%s", image_fname, JOURNAL_SUFFIX);
+    }
+    return name;
+}
+
+static Status write_all(int fd, const unsigned char *buf, size_t len, off_t offset)
+{
+    while (len > 0)
+    {
+        ssize_t n = pwrite(fd, buf, len, offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            perror("pwrite");
+            return e_failure;
+        }
+        buf += n;
+        len -= n;
+        offset += n;
+    }
+    return e_success;
+}
+
+/* Make a new directory entry in the directory of fname durable */
+static void sync_parent_dir(const char *fname)
+{
+    const char *slash = strrchr(fname, '/');
+    char *dir = slash != NULL ? strndup(fname, slash == fname ? 1 : slash - fname) : strdup(".");
+    int fd = dir != NULL ? open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC) : -1;
+
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+/* Check every record lies inside the body and the image */
+static int journal_valid(const JournalHeader *hdr, const unsigned char *body, size_t body_size, size_t image_size)
+{
+    size_t pos = 0;
+
+    if (memcmp(hdr->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || hdr->body_size != body_size ||
+        hdr->image_size != image_size || crc32c_update(0, body, body_size) != hdr->crc)
+    {
+        return 0;
+    }
+    for (uint i = 0; i < hdr->count; i++)
+    {
+        JournalRecord rec;
+
+        if (body_size - pos < sizeof(rec))
+        {
+            return 0;
+        }
+        memcpy(&rec, body + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (rec.len > body_size - pos || rec.offset > image_size || rec.len > image_size - rec.offset)
+        {
+            return 0;
+        }
+        pos += rec.len;
+    }
+    return pos == body_size;
+}
+
+/* Write every record to the image and sync it */
+static Status journal_apply(int fd, const unsigned char *body, uint count)
+{
+    size_t pos = 0;
+
+    for (uint i = 0; i < count; i++)
+    {
+        JournalRecord rec;
+
+        memcpy(&rec, body + pos, sizeof(rec));
+        pos += sizeof(rec);
+        if (write_all(fd, body + pos, rec.len, rec.offset) == e_failure)
+        {
+            return e_failure;
+        }
+        pos += rec.len;
+    }
+    if (fsync(fd) != 0)
+    {
+        perror("fsync");
+        return e_failure;
+    }
+    return e_success;
+}
+
+Status update_recover(const char *image_fname)
+{
+    char *jname = journal_name(image_fname);
+    unsigned char *journal = NULL;
+    JournalHeader hdr;
+    struct stat st, image_st;
+    int jfd, fd = -1;
+    Status ret = e_failure;
+
+    if (jname == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    jfd = open(jname, O_RDONLY | O_CLOEXEC);
+    if (jfd < 0)
+    {
+        free(jname);
+        return errno == ENOENT ? e_success : e_failure;  // No journal, no interrupted update
+    }
+    if (fstat(jfd, &st) != 0 || (journal = malloc(st.st_size > 0 ? st.st_size : 1)) == NULL ||
+        pread(jfd, journal, st.st_size, 0) != st.st_size)
+    {
+        fprintf(stderr, "ERROR: Unable to read %s\n", jname);
+        goto done;
+    }
+    fd = open(image_fname, O_RDWR | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &image_st) != 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", image_fname);
+        goto done;
+    }
+
+    // The image is only written once the whole journal is on disk, so a bad journal means an untouched image
+    if ((size_t)st.st_size < sizeof(hdr) ||
+        (memcpy(&hdr, journal, sizeof(hdr)),
+         !journal_valid(&hdr, journal + sizeof(hdr), st.st_size - sizeof(hdr), image_st.st_size)))
+    {
+        LOG_INFO("INFO: Dropped the incomplete journal of %s, the image was not changed\n", image_fname);
+    }
+    else if (journal_apply(fd, journal + sizeof(hdr), hdr.count) == e_failure)
+    {
+        fprintf(stderr, "ERROR: Unable to finish the interrupted update of %s\n", image_fname);
+        goto done;
+    }
+    else
+    {
+        LOG_INFO("INFO: Finished an interrupted update of %s\n", image_fname);
+    }
+    unlink(jname);
+    ret = e_success;
+
+done:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    close(jfd);
+    free(journal);
+    free(jname);
+    return ret;
+}
+
+static Status body_append(JournalBody *body, size_t offset, const unsigned char *bytes, size_t len)
+{
+    JournalRecord rec = { offset, len };
+
+    if (body->cap - body->size < sizeof(rec) + len)
+    {
+        size_t cap = body->cap ? body->cap : 4096;
+        unsigned char *grown;
+
+        while (cap - body->size < sizeof(rec) + len)
+        {
+            cap *= 2;
+        }
+        grown = realloc(body->data, cap);
+        if (grown == NULL)
+        {
+            fprintf(stderr, "ERROR: Out of memory\n");
+            return e_failure;
+        }
+        body->data = grown;
+        body->cap = cap;
+    }
+    memcpy(body->data + body->size, &rec, sizeof(rec));
+    memcpy(body->data + body->size + sizeof(rec), bytes, len);
+    body->size += sizeof(rec) + len;
+    body->count++;
+    body->changed += len;
+    return e_success;
+}
+
+/* Record the runs of bytes where the new prefix differs from the image */
+static Status diff_prefix(const unsigned char *image, const unsigned char *out, size_t prefix, JournalBody *body)
+{
+    size_t i = 0;
+
+    while (i < prefix)
+    {
+        size_t end, same = 0;
+
+        if (out[i] == image[i])
+        {
+            i++;
+            continue;
+        }
+        // Extend the run over short stretches of unchanged bytes
+        end = i + 1;
+        for (size_t j = end; j < prefix && same <= RUN_GAP; j++)
+        {
+            if (out[j] != image[j])
+            {
+                end = j + 1;
+                same = 0;
+            }
+            else
+            {
+                same++;
+            }
+        }
+        if (body_append(body, i, out + i, end - i) == e_failure)
+        {
+            return e_failure;
+        }
+        i = end;
+    }
+    return e_success;
+}
+
+/* Sync the journal, write the runs to the image, sync it and drop the journal */
+static Status commit_update(const char *image_fname, int fd, size_t image_size, const JournalBody *body)
+{
+    char *jname = journal_name(image_fname);
+    JournalHeader hdr;
+    int jfd;
+
+    if (jname == NULL)
+    {
+        fprintf(stderr, "ERROR: Out of memory\n");
+        return e_failure;
+    }
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    hdr.image_size = image_size;
+    hdr.body_size = body->size;
+    hdr.count = body->count;
+    hdr.crc = crc32c_update(0, body->data, body->size);
+
+    jfd = open(jname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (jfd < 0 || write_all(jfd, (const unsigned char *)&hdr, sizeof(hdr), 0) == e_failure ||
+        write_all(jfd, body->data, body->size, sizeof(hdr)) == e_failure || fsync(jfd) != 0)
+    {
+        fprintf(stderr, "ERROR: Unable to write %s, %s was not changed\n", jname, image_fname);
+        if (jfd >= 0)
+        {
+            close(jfd);
+        }
+        unlink(jname);
+        free(jname);
+        return e_failure;
+    }
+    close(jfd);
+    sync_parent_dir(jname);
+
+    if (journal_apply(fd, body->data, body->count) == e_failure)
+    {
+        fprintf(stderr, "ERROR: Update of %s interrupted, the next update of it finishes it\n", image_fname);
+        free(jname);
+        return e_failure;
+    }
+    unlink(jname);
+    free(jname);
+    return e_success;
+}
+
+Status do_update(const char *image_fname, const char *secret_fname, const char *magic, const StegOptions *opts)
+{
+    struct stat st;
+    size_t image_size = 0, secret_size = 0, prefix = 0;
+    unsigned char *image = MAP_FAILED, *secret = MAP_FAILED, *out = MAP_FAILED;
+    const char *extn = secret_file_extn(secret_fname);  // Empty for a name without a dot
+    JournalBody body;
+    StegHeader hdr;
+    StegOptions update_opts = *opts;
+    int fd, secret_fd;
+    Status ret = e_failure;
+
+    memset(&body, 0, sizeof(body));
+    if (update_recover(image_fname) == e_failure)
+    {
+        return e_failure;
+    }
+
+    fd = open(image_fname, O_RDWR | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", image_fname);
+        goto done;
+    }
+    image_size = st.st_size;
+    image = map_file(fd, image_size, PROT_READ);
+    secret_fd = open(secret_fname, O_RDONLY | O_CLOEXEC);
+    if (secret_fd < 0 || fstat(secret_fd, &st) != 0)
+    {
+        perror("open");
+        fprintf(stderr, "ERROR: Unable to open file %s\n", secret_fname);
+        if (secret_fd >= 0)
+        {
+            close(secret_fd);
+        }
+        goto done;
+    }
+    secret_size = st.st_size;
+    secret = map_file(secret_fd, secret_size, PROT_READ);
+    close(secret_fd);
+    if (image == MAP_FAILED || secret == MAP_FAILED)
+    {
+        goto done;
+    }
+
+    if (steg_read_header(image, image_size, magic, &hdr, NULL) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto done;
+    }
+    if (hdr.shard.count > 0 || hdr.is_archive)
+    {
+        fprintf(stderr, "ERROR: %s holds %s, only a single secret file can be updated\n", image_fname,
+                hdr.is_archive ? "an archive" : "one shard of a split secret");
+        goto done;
+    }
+    // Keep the image as it was encoded
+    update_opts.lsb_depth = hdr.lsb_depth;
+    update_opts.compress = hdr.codec == CODEC_LZ;
+    update_opts.channel_mask = hdr.bmp.channel_mask;
+
+    // Only the pages of the new prefix are ever touched, so reserve no memory for the rest
+    out = mmap(NULL, image_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (out == MAP_FAILED)
+    {
+        perror("mmap");
+        goto done;
+    }
+    if (steg_embed_prefix(image, image_size, secret, secret_size, extn, magic,
+                          &update_opts, out, &prefix) == e_failure)
+    {
+        fprintf(stderr, "ERROR: %s\n", steg_last_error());
+        goto done;
+    }
+    if (diff_prefix(image, out, prefix, &body) == e_failure)
+    {
+        goto done;
+    }
+    if (body.count > 0 && commit_update(image_fname, fd, image_size, &body) == e_failure)
+    {
+        goto done;
+    }
+    LOG_INFO("INFO: %zu bytes rewritten in %u runs, %zu of %zu image bytes compared\n",
+             body.changed, body.count, prefix, image_size);
+    ret = e_success;
+
+done:
+    if (out != MAP_FAILED)
+    {
+        munmap(out, image_size);
+    }
+    free(body.data);
+    if (secret != MAP_FAILED && secret != NULL)
+    {
+        munmap(secret, secret_size);
+    }
+    if (image != MAP_FAILED && image != NULL)
+    {
+        munmap(image, image_size);
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return ret;
+}
+
+#else
+
+Status do_update(const char *image_fname, const char *secret_fname, const char *magic, const StegOptions *opts)
+{
+    fprintf(stderr, "ERROR: Update mode is not supported on this platform\n");
+    return e_failure;
+}
+
+Status update_recover(const char *image_fname)
+{
+    fprintf(stderr, "ERROR: Update mode is not supported on this platform\n");
+    return e_failure;
+}
+
+#endif
@@ -0,0 +1,31 @@
+/*
+Name : Sharan
+Date : 20/10/2024
+Description : Implementation of LSB image Steganography project
+*/
+
+#ifndef UPDATE_H
+#define UPDATE_H
+
+#include "types.h" // Contains user defined types
+
+/*
+ * Update mode: replace the secret of a stego image in place. The new
+ * stego image is built only up to its last carrier byte, compared with the
+ * image on disk and only the bytes that differ are written, so a small
+ * edit of a secret in a large carrier rewrites a few kilobytes.
+ *
+ * The changed runs go to a redo journal next to the image,
+ * <image>.journal, which is synced before the image is touched and removed
+ * once the image is synced. A crash leaves either an incomplete journal
+ * and an untouched image, or a complete journal that the next update of
+ * the image replays first.
+ */
+
+/* Replace the secret of image_fname with secret_fname, keeping the LSB depth and codec of the image */
+Status do_update(const char *image_fname, const char *secret_fname, const char *magic, const StegOptions *opts);
+
+/* Finish an interrupted update of image_fname, if there is one */
+Status update_recover(const char *image_fname);
+
+#endif